@@ -14,6 +14,28 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include "liquidcrystal_i2c.h"
+#include "payload_dictionary.h"  // Generated by tools/train_dictionary.py, shared with the encoder
+
+/* Link transport - chosen at build time, must match the encoder */
+#define TRANSPORT_UART 0     // huart1, blocking
+#define TRANSPORT_SPI 1      // SPI1 slave with DMA, for boards mounted side by side
+#define TRANSPORT_HOSTSIM 2  // pty named by SECUREEDU_LINK, built with tools/hostsim - see hal_host.c
+#define LINK_TRANSPORT TRANSPORT_UART
+
+/* UART receive - huart1 lands in a circular DMA ring, drained by the parser */
+#define ENABLE_DMA_RX 1
+#define RX_RING_SIZE 1024  // Must be a power of two
+#define RX_RING_ACTIVE (ENABLE_DMA_RX && LINK_TRANSPORT == TRANSPORT_UART)
+
+#if RX_RING_ACTIVE && (RX_RING_SIZE & (RX_RING_SIZE - 1))
+#error "RX_RING_SIZE must be a power of two"
+#endif
+
+#if LINK_TRANSPORT == TRANSPORT_HOSTSIM
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 /* Constants -----------------------------------------------------------------*/
 #define ACCESS_KEY_SIZE 8
@@ -25,6 +47,45 @@
 #define KEYPAD_ROWS 4
 #define KEYPAD_COLS 4
 #define DEBOUNCE_DELAY 200  // ms
+#define MAX_BATCH_MESSAGES 8  // Must match MAX_BATCH_SELECTIONS on the encoder
+#define ENABLE_DECRYPT_ON_RECEIVE 1  // Decrypt each chunk as the receive ring hands it over
+#define DICT_MATCH_MIN 4  // Must match the encoder and tools/train_dictionary.py
+
+/* Block pool - message buffers come from here instead of the heap */
+#define POOL_BOARD POOL_BOARD_FINAL_DECODER  // Block sizes and counts are in block_pool.h
+
+/* Frame markers */
+#define START_MARKER 0xAA
+#define BATCH_START_MARKER 0xAB
+#define BROADCAST_START_MARKER 0xAC
+#define BROADCAST_BATCH_START_MARKER 0xAD
+#define COMPRESSED_MARKER_FLAG 0x10  // Or'd into any start marker - payload is dictionary compressed
+#define END_MARKER 0x55
+
+/* Broadcast addressing - provisioned per board, must match the encoder's RECIPIENTS table */
+#define DECODER_ADDRESS 0x01
+#define ENVELOPE_SIZE (1 + ACCESS_KEY_SIZE)  // Address + wrapped access key
+
+/* Channel bonding - must match the encoder */
+#define ENABLE_CHANNEL_BONDING 0  // Payload striped across huart1 and huart6
+#define BOND_PORTS 2              // Must match the bondPorts table
+#define BOND_CHUNK_SIZE 64
+#define BOND_HEADER_SIZE 3        // Sequence number (LE16) + chunk length
+#define BOND_RX_TIMEOUT 1000      // ms without a chunk before a port is declared failed
+
+#if ENABLE_CHANNEL_BONDING && LINK_TRANSPORT != TRANSPORT_UART
+#error "Channel bonding requires the UART transport"
+#endif
+
+/* Link status byte returned to the encoder's pacing controller */
+#define LINK_ACK 0x06
+#define LINK_NAK 0x15
+
+/* Loopback link benchmark */
+#define ENABLE_LINK_BENCHMARK 0  // Run the PA9->PA10 loopback sweep at boot
+#define BENCH_BYTES_PER_RUN 4096
+#define BENCH_MAX_CHUNKS (BENCH_BYTES_PER_RUN / 16)
+#define BENCH_RX_SLACK_US 20000  // Added to the expected wire time before a chunk times out
 
 /* GPIO Pin Definitions */
 #define ROW1_PIN GPIO_PIN_0
@@ -44,7 +105,12 @@
 /* Private variables ---------------------------------------------------------*/
 UART_HandleTypeDef huart1;  // For receiving data
 UART_HandleTypeDef huart2;  // For debug output
+UART_HandleTypeDef huart6;  // Second bonded port
 I2C_HandleTypeDef hi2c1;
+DMA_HandleTypeDef hdma_usart1_rx;
+DMA_HandleTypeDef hdma_usart6_rx;
+SPI_HandleTypeDef hspi1;    // SPI transport from encoder
+DMA_HandleTypeDef hdma_spi1_rx;
 
 /* Keypad Configuration */
 const uint16_t ROW_PINS[KEYPAD_ROWS] = {ROW1_PIN, ROW2_PIN, ROW3_PIN, ROW4_PIN};
@@ -67,15 +133,80 @@ typedef struct {
 
 static KeypadInput keypadState = {0};
 static uint8_t receivedAccessKey[ACCESS_KEY_SIZE + 1] = {0};
-static bool accessKeyReceived = false;
 static uint8_t decryption_key[KEY_SIZE] = {0};
-static uint8_t encrypted_buffer[MAX_DATA_SIZE] = {1};
+static const uint8_t DEVICE_KEY[KEY_SIZE] = {
+		0x3B, 0x91, 0x5E, 0x07, 0xC4, 0x28, 0xA6, 0x7D, 0x12, 0xE9, 0x40, 0xB3, 0x6F, 0x85, 0x1C, 0xD2
+};
+
+/* Keystream state, so the payload can be decrypted a piece at a time */
+typedef struct {
+	uint8_t key[KEY_SIZE];
+	uint8_t keyStream[KEY_SIZE];
+	size_t position;
+} DecryptStream;
+
+static DecryptStream rxCipher;
+static uint8_t* rxPayload = NULL;  // Payload being received, decrypted in place
+
+/* Messages carried by the last frame - a single frame is a batch of one */
+typedef struct {
+	uint32_t offset;       // Payload bytes
+	uint32_t size;
+	uint32_t text_offset;  // Plaintext in rxText - the payload itself unless compressed
+	uint32_t text_size;
+} ReceivedMessage;
+
+static ReceivedMessage messages[MAX_BATCH_MESSAGES];
+static uint8_t messageCount = 0;
+
+/* Codec field of a compressed frame, sent in clear after the size or directory */
+typedef struct {
+	uint32_t dictionary;  // Must be PAYLOAD_DICT_CRC
+	uint32_t text_size;   // Plaintext bytes across all messages
+} PayloadCodec;
+
+/* Inflate of a compressed frame into rxText, run behind the decryption.
+ * Each message inflates on its own against the shared dictionary. */
+typedef struct {
+	bool active;
+	bool error;
+	uint8_t message;   // Message being inflated
+	uint32_t in_pos;   // Next payload byte
+	uint32_t out_pos;  // Next rxText byte
+	uint32_t capacity;
+} InflateStream;
+
+static InflateStream rxInflate;
+static uint8_t* rxText = NULL;  // Inflated plaintext of a compressed frame
+
+static volatile bool benchRxDone = false;
+
+/* Receive ring - DMA writes it continuously, the HT/TC/IDLE events publish
+ * how far it got. Counters are free-running so a lap is detectable. */
+static volatile uint32_t rxProduced = 0;
+#if RX_RING_ACTIVE
+static uint8_t rxRing[RX_RING_SIZE];
+static uint32_t rxConsumed = 0;
+static uint16_t rxLastPos = 0;
+#endif
+static volatile uint32_t rxDropped = 0;
 
 /* Function Prototypes */
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+#if LINK_TRANSPORT == TRANSPORT_UART
 static void MX_USART1_UART_Init(void);
+#endif
 static void MX_USART2_UART_Init(void);
+#if ENABLE_CHANNEL_BONDING
+static void MX_USART6_UART_Init(void);
+#endif
+#if ENABLE_CHANNEL_BONDING || RX_RING_ACTIVE
+static void MX_DMA_Init(void);
+#endif
+#if LINK_TRANSPORT == TRANSPORT_SPI
+static void MX_SPI1_Init(void);
+#endif
 static void MX_I2C1_Init(void);
 void Error_Handler(void);
 void Keypad_Init(void);
@@ -83,29 +214,516 @@ char Keypad_Scan(void);
 bool ProcessKeypadInput(void);
 void deriveKeyFromAccessKey(const uint8_t* access_key, uint32_t timestamp, uint8_t* key);
 void decryptData(uint8_t* data, size_t length, const uint8_t* key);
+void decryptUpdate(DecryptStream* stream, uint8_t* data, size_t length);
+static void decryptReceived(uint32_t end);
 void displayTextOnLCD(const char* text, size_t length);
-HAL_StatusTypeDef UART_Receive_Safe(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size, uint32_t timeout);
+void runLinkBenchmark(void);
+void unwrapAccessKey(const uint8_t* device_key, uint32_t timestamp, const uint8_t* in, uint8_t* out);
+HAL_StatusTypeDef receiveEnvelopes(uint8_t* wrapped_key, bool* addressed);
+HAL_StatusTypeDef drainFrame(uint32_t length);
+HAL_StatusTypeDef receiveBonded(uint8_t* dest, uint32_t size);
+void Link_Init(void);
+HAL_StatusTypeDef Link_Receive(uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef Link_Transmit(const uint8_t *data, uint16_t size);
+void sendLinkStatus(bool broadcast, uint8_t linkStatus);
+void rxRingStart(void);
+
+/* Block Pool */
+#include "block_pool.h"  // Shared with tools/pool_soak.c
+
+/* Link Transport */
+#if LINK_TRANSPORT == TRANSPORT_SPI
+static volatile bool spiRxDone = false;
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) {
+	if (hspi == &hspi1) {
+		spiRxDone = true;
+	}
+}
+#elif LINK_TRANSPORT == TRANSPORT_HOSTSIM
+static int hostsimFd = -1;
+#endif
+
+#if RX_RING_ACTIVE
+/* (Re)arm the ring. Anything the parser had not read yet is counted as dropped. */
+void rxRingStart(void) {
+	rxDropped += rxProduced - rxConsumed;
+	rxConsumed = rxProduced;
+	rxLastPos = 0;
+	HAL_UARTEx_ReceiveToIdle_DMA(&huart1, rxRing, RX_RING_SIZE);
+}
+
+/* Fires at half and full ring and whenever the line goes idle. Size is the
+ * DMA write position, so this is the only place the produced count moves. */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
+	if (huart != &huart1) {
+		return;
+	}
+	uint16_t pos = Size & (RX_RING_SIZE - 1);
+	rxProduced += (uint16_t)(pos - rxLastPos) & (RX_RING_SIZE - 1);
+	rxLastPos = pos;
+}
+
+/* Copy size bytes out of the ring, sleeping between DMA events */
+static HAL_StatusTypeDef rxRingRead(uint8_t *data, uint16_t size, uint32_t timeout) {
+	uint32_t tickstart = HAL_GetTick();
+
+	while (size > 0) {
+		uint32_t available = rxProduced - rxConsumed;
+		if (available > RX_RING_SIZE) {
+			// DMA lapped the parser, so the unread bytes are already overwritten
+			rxDropped += available;
+			rxConsumed += available;
+			return HAL_ERROR;
+		}
+		if (available == 0) {
+			if ((HAL_GetTick() - tickstart) >= timeout) {
+				return HAL_TIMEOUT;
+			}
+			__WFI();  // Next ring event or SysTick
+			continue;
+		}
+
+		uint16_t tail = rxConsumed & (RX_RING_SIZE - 1);
+		uint16_t count = RX_RING_SIZE - tail;
+		if (count > available) count = available;
+		if (count > size) count = size;
+
+		memcpy(data, &rxRing[tail], count);
+		rxConsumed += count;
+		data += count;
+		size -= count;
+	}
+	return HAL_OK;
+}
+#endif
+
+void Link_Init(void) {
+#if LINK_TRANSPORT == TRANSPORT_SPI
+	MX_SPI1_Init();
+#elif LINK_TRANSPORT == TRANSPORT_HOSTSIM
+	const char* path = getenv("SECUREEDU_LINK");
+	hostsimFd = path ? open(path, O_RDWR | O_NOCTTY) : -1;
+	if (hostsimFd < 0) {
+		printf("SECUREEDU_LINK not set or not openable - see tools/link_pair.c\r\n");
+		Error_Handler();
+	}
+#else
+	MX_USART1_UART_Init();
+#endif
+}
+
+/* Receive exactly size bytes from the encoder or time out */
+HAL_StatusTypeDef Link_Receive(uint8_t *data, uint16_t size, uint32_t timeout) {
+#if LINK_TRANSPORT == TRANSPORT_SPI
+	// Slave DMA is armed before the master clocks; the encoder's inter-field gaps leave room for it
+	spiRxDone = false;
+	HAL_StatusTypeDef status = HAL_SPI_Receive_DMA(&hspi1, data, size);
+	if (status != HAL_OK) {
+		return status;
+	}
 
-HAL_StatusTypeDef UART_Receive_Safe(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size, uint32_t timeout) {
+	uint32_t tickstart = HAL_GetTick();
+	while (!spiRxDone) {
+		if ((HAL_GetTick() - tickstart) >= timeout) {
+			HAL_SPI_Abort(&hspi1);
+			return HAL_TIMEOUT;
+		}
+	}
+	return HAL_OK;
+#elif LINK_TRANSPORT == TRANSPORT_HOSTSIM
 	uint32_t tickstart = HAL_GetTick();
 	uint16_t received = 0;
 
 	while (received < size) {
-		if ((HAL_GetTick() - tickstart) >= timeout) {
+		uint32_t elapsed = HAL_GetTick() - tickstart;
+		struct pollfd pfd = { .fd = hostsimFd, .events = POLLIN };
+		if (elapsed >= timeout || poll(&pfd, 1, timeout - elapsed) <= 0) {
 			return HAL_TIMEOUT;
 		}
+		ssize_t n = read(hostsimFd, &data[received], size - received);
+		if (n <= 0) {
+			return HAL_ERROR;
+		}
+		received += n;
+	}
+	return HAL_OK;
+#elif ENABLE_DMA_RX
+	return rxRingRead(data, size, timeout);
+#else
+	return HAL_UART_Receive(&huart1, data, size, timeout);
+#endif
+}
 
-		HAL_StatusTypeDef status = HAL_UART_Receive(huart, &data[received], 1, 100);
-		if (status == HAL_OK) {
-			received++;
-		} else if (status != HAL_TIMEOUT) {
+/* Send size bytes back to the encoder */
+HAL_StatusTypeDef Link_Transmit(const uint8_t *data, uint16_t size) {
+#if LINK_TRANSPORT == TRANSPORT_SPI
+	// Blocks until the master clocks the bytes out
+	return HAL_SPI_Transmit(&hspi1, (uint8_t*)data, size, 200);
+#elif LINK_TRANSPORT == TRANSPORT_HOSTSIM
+	return (write(hostsimFd, data, size) == size) ? HAL_OK : HAL_ERROR;
+#else
+	return HAL_UART_Transmit(&huart1, (uint8_t*)data, size, 100);
+#endif
+}
+
+/* DWT cycle counter, used for the decrypt latency figure and the link benchmark */
+static void enableCycleCounter(void) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/* Payload Inflate */
+/* The encoder's format, see tools/train_dictionary.py: catalog-style tokens
+ * with a two-byte distance back through the message's output and on into
+ * the end of PAYLOAD_DICT. Zero padding decodes as empty sequences. */
+static void inflateInit(uint8_t* out, uint32_t capacity) {
+	memset(&rxInflate, 0, sizeof(rxInflate));
+	rxInflate.active = true;
+	rxInflate.capacity = capacity;
+	rxText = out;
+	messages[0].text_offset = 0;
+}
+
+/* Return a frame's payload block, and its text block if it was inflated */
+static void releaseFrame(uint8_t* payload) {
+	if(rxText != payload) {
+		poolFree(rxText);
+	}
+	rxText = NULL;
+	rxInflate.active = false;
+	poolFree(payload);
+}
+
+/* Literal count or match code at rxPayload[*pos]. Returns false if its
+ * extension bytes run past available. */
+static bool inflateLength(uint32_t* pos, uint32_t available, uint32_t nibble, uint32_t* length) {
+	*length = nibble;
+	if(nibble == 15) {
+		uint8_t b;
+		do {
+			if(*pos >= available) {
+				return false;
+			}
+			b = rxPayload[(*pos)++];
+			*length += b;
+		} while(b == 255);
+	}
+	return true;
+}
+
+/* Inflate the sequence at in_pos if all of it lies below available.
+ * Returns 1 once done, 0 to wait for more payload and -1 if it is corrupt. */
+static int inflateSequence(InflateStream* s, uint32_t available, uint32_t message_end) {
+	int incomplete = (available < message_end) ? 0 : -1;
+	uint32_t pos = s->in_pos;
+	uint32_t literals, code, distance = 0;
+	uint8_t token = rxPayload[pos++];
+
+	if(!inflateLength(&pos, available, token >> 4, &literals) ||
+			!inflateLength(&pos, available, token & 0x0F, &code)) {
+		return incomplete;
+	}
+	if(code) {
+		if(pos + 2 > available) {
+			return incomplete;
+		}
+		distance = rxPayload[pos] | (rxPayload[pos + 1] << 8);
+		pos += 2;
+	}
+	if(literals > available - pos) {
+		return incomplete;
+	}
+
+	uint32_t match = code ? code + DICT_MATCH_MIN - 1 : 0;
+	if(literals + match > s->capacity - s->out_pos) {
+		return -1;
+	}
+	memcpy(&rxText[s->out_pos], &rxPayload[pos], literals);
+	s->out_pos += literals;
+	pos += literals;
+
+	// History is the dictionary followed by this message's output
+	uint32_t history = PAYLOAD_DICT_SIZE + (s->out_pos - messages[s->message].text_offset);
+	if(match && (distance == 0 || distance > history)) {
+		return -1;
+	}
+	for(uint32_t n = 0; n < match; n++, history++) {
+		uint32_t from = history - distance;
+		rxText[s->out_pos++] = (from < PAYLOAD_DICT_SIZE) ? PAYLOAD_DICT[from] :
+				rxText[messages[s->message].text_offset + from - PAYLOAD_DICT_SIZE];
+	}
+	s->in_pos = pos;
+	return 1;
+}
+
+/* Inflate every whole sequence of rxPayload below end, message by message */
+static void inflateReceived(uint32_t end) {
+	InflateStream* s = &rxInflate;
+
+	while(s->active && !s->error && s->message < messageCount) {
+		ReceivedMessage* m = &messages[s->message];
+		uint32_t message_end = m->offset + m->size;
+
+		if(s->in_pos == message_end) {
+			m->text_size = s->out_pos - m->text_offset;
+			if(++s->message < messageCount) {
+				messages[s->message].text_offset = s->out_pos;
+			}
+			continue;
+		}
+		if(s->in_pos >= end) {
+			return;
+		}
+		int result = inflateSequence(s, (end < message_end) ? end : message_end, message_end);
+		if(result == 0) {
+			return;
+		}
+		s->error = (result < 0);
+	}
+}
+
+/* Decrypt rxPayload up to end - called as the payload arrives, and once
+ * more after the end marker for whatever is left. A compressed payload is
+ * inflated right behind. */
+static void decryptReceived(uint32_t end) {
+	if(end > rxCipher.position) {
+		decryptUpdate(&rxCipher, &rxPayload[rxCipher.position], end - rxCipher.position);
+	}
+	inflateReceived(rxCipher.position);
+}
+
+/* Report the frame outcome to the encoder's pacing controller. Broadcast
+ * frames get no reply since several decoders would collide on the bus,
+ * and bonded frames are not paced. */
+void sendLinkStatus(bool broadcast, uint8_t linkStatus) {
+#if !ENABLE_CHANNEL_BONDING
+	if(!broadcast) {
+		Link_Transmit(&linkStatus, 1);
+	}
+#else
+	(void)broadcast;
+	(void)linkStatus;
+#endif
+}
+
+/* Broadcast Envelopes */
+/* Per-frame envelope pad: the frame timestamp enciphered under the device key
+ * with Speck64/128 (64-bit block, 128-bit key, 27 rounds). An addressed
+ * decoder learns the access key and so every other envelope's pad, but a pad
+ * is a cipher output, so it gives away neither the device key behind it nor
+ * the pad for any other timestamp. Pads repeat only if a timestamp does - it
+ * is HAL_GetTick, so across power cycles. Keep in step with envelopePad in FINAL_ENCODER.c. */
+static uint32_t padRor(uint32_t x, int r) { return (x >> r) | (x << (32 - r)); }
+static uint32_t padRol(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+
+static void envelopePad(const uint8_t* device_key, uint32_t timestamp, uint8_t* pad) {
+	uint32_t l[3];
+	uint32_t k;
+	uint32_t x = timestamp;
+	uint32_t y = 0x57524150;  // "WRAP", keeps the block apart from other uses of the key
+
+	memcpy(&k, device_key, 4);  // Little-endian words, k first
+	memcpy(l, device_key + 4, 12);
+	for(uint32_t i = 0; i < 27; i++) {
+		x = (padRor(x, 8) + y) ^ k;
+		y = padRol(y, 3) ^ x;
+		uint32_t next = (k + padRor(l[i % 3], 8)) ^ i;
+		k = padRol(k, 3) ^ next;
+		l[i % 3] = next;
+	}
+	memcpy(pad, &x, 4);
+	memcpy(pad + 4, &y, 4);
+}
+
+void unwrapAccessKey(const uint8_t* device_key, uint32_t timestamp, const uint8_t* in, uint8_t* out) {
+	uint8_t pad[ACCESS_KEY_SIZE];
+	envelopePad(device_key, timestamp, pad);
+	for(int i = 0; i < ACCESS_KEY_SIZE; i++) {
+		out[i] = in[i] ^ pad[i];
+	}
+}
+
+/* Read the envelope table and keep the one addressed to this decoder, if any */
+HAL_StatusTypeDef receiveEnvelopes(uint8_t* wrapped_key, bool* addressed) {
+	uint8_t count = 0;
+	uint8_t envelope[ENVELOPE_SIZE];
+
+	*addressed = false;
+	HAL_StatusTypeDef status = Link_Receive(&count, 1, 1000);
+	if(status != HAL_OK) {
+		return status;
+	}
+
+	for(int i = 0; i < count; i++) {
+		status = Link_Receive(envelope, ENVELOPE_SIZE, 1000);
+		if(status != HAL_OK) {
 			return status;
 		}
-		HAL_Delay(1);
+		if(envelope[0] == DECODER_ADDRESS) {
+			memcpy(wrapped_key, &envelope[1], ACCESS_KEY_SIZE);
+			*addressed = true;
+		}
+	}
+	return HAL_OK;
+}
+
+/* Skip the rest of a frame meant for other decoders without storing or decrypting it */
+HAL_StatusTypeDef drainFrame(uint32_t length) {
+	uint8_t scratch[32];
+
+	while(length > 0) {
+		uint16_t chunk_size = (length > sizeof(scratch)) ? sizeof(scratch) : length;
+		HAL_StatusTypeDef status = Link_Receive(scratch, chunk_size, 1000);
+		if(status != HAL_OK) {
+			return status;
+		}
+		length -= chunk_size;
 	}
 	return HAL_OK;
 }
 
+/* Channel Bonding */
+#define BOND_RECEIVE 1
+#if RX_RING_ACTIVE
+#define BOND_RING_PORT (&huart1)  // huart1 chunks come out of the receive ring instead of a per-chunk DMA
+#endif
+#if ENABLE_DECRYPT_ON_RECEIVE
+#define BOND_RX_PREFIX(end) decryptReceived(end)
+#endif
+
+static UART_HandleTypeDef* const bondPorts[BOND_PORTS] = {&huart1, &huart6};
+
+#include "channel_bond.h"  // Shared with the encoder and tools/bond_reassembly.c
+
+#if RX_RING_ACTIVE
+static HAL_StatusTypeDef bondRingRead(uint8_t* frame, uint16_t length) {
+	if(rxProduced - rxConsumed < length) {
+		return HAL_BUSY;
+	}
+	return rxRingRead(frame, length, 0);
+}
+#endif
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+	if(huart == &huart1) {
+		benchRxDone = true;
+	}
+	bondRxComplete(huart);
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+#if RX_RING_ACTIVE
+	// Overrun or framing error stops the DMA - restart the ring
+	if(huart == &huart1) {
+		HAL_UART_AbortReceive(&huart1);
+		rxRingStart();
+	}
+#endif
+	bondRxError(huart);
+}
+
+/* Link Benchmark */
+/* TX->RX loopback on huart1 (jumper PA9 to PA10) across baud rates, chunk
+ * sizes and gaps. Reports goodput, corrupt and timed-out chunks and per-chunk latency
+ * percentiles on the debug UART. tools/link_bench.c runs the same sweep on a
+ * pty pair so host and target numbers line up. */
+static const uint32_t BENCH_BAUDS[] = {115200, 230400, 460800, 921600};
+static const uint16_t BENCH_CHUNKS[] = {16, 32, 64, 128, 256};
+static const uint16_t BENCH_GAPS[] = {0, 2, 10};
+
+static uint8_t benchTx[256];
+static uint8_t benchRx[256];
+static uint32_t benchLatency[BENCH_MAX_CHUNKS];
+
+/* Microseconds since a CYCCNT reading - subtracting before dividing keeps
+ * intervals right across the counter wrap */
+static uint32_t benchMicrosSince(uint32_t start) {
+	return (DWT->CYCCNT - start) / (SystemCoreClock / 1000000u);
+}
+
+static void benchSort(uint32_t* values, uint32_t count) {
+	for (uint32_t i = 1; i < count; i++) {
+		uint32_t v = values[i];
+		uint32_t j = i;
+		while (j > 0 && values[j - 1] > v) {
+			values[j] = values[j - 1];
+			j--;
+		}
+		values[j] = v;
+	}
+}
+
+static void benchRun(uint32_t baud, uint16_t chunk, uint16_t gap) {
+	uint32_t chunks = BENCH_BYTES_PER_RUN / chunk;
+	uint32_t corrupt = 0;
+	uint32_t timeouts = 0;
+	uint32_t goodBytes = 0;
+	// Expected wire time for 8N1 plus slack before a chunk counts as lost
+	uint32_t timeoutUs = chunk * 10u * 1000000u / baud + BENCH_RX_SLACK_US;
+
+	uint32_t start = DWT->CYCCNT;
+	for (uint32_t c = 0; c < chunks; c++) {
+		for (uint16_t i = 0; i < chunk; i++) {
+			benchTx[i] = (uint8_t)(c * 31u + i * 7u + 0x5A);
+		}
+		memset(benchRx, 0, chunk);
+
+		benchRxDone = false;
+		uint32_t t0 = DWT->CYCCNT;
+		HAL_UART_Receive_IT(&huart1, benchRx, chunk);
+		HAL_UART_Transmit(&huart1, benchTx, chunk, HAL_MAX_DELAY);
+		while (!benchRxDone && benchMicrosSince(t0) < timeoutUs) {
+		}
+		benchLatency[c] = benchMicrosSince(t0);
+
+		// A chunk that never completed is lost; one that completed wrong is corrupt
+		if (!benchRxDone) {
+			timeouts++;
+			HAL_UART_AbortReceive(&huart1);
+		} else if (memcmp(benchTx, benchRx, chunk) != 0) {
+			corrupt++;
+		} else {
+			goodBytes += chunk;
+		}
+		HAL_Delay(gap);
+	}
+	uint32_t elapsed = benchMicrosSince(start);
+
+	benchSort(benchLatency, chunks);
+	printf("baud=%lu chunk=%u gap=%u goodput=%lu B/s corrupt=%lu/%lu timeouts=%lu/%lu p50=%lu us p90=%lu us p99=%lu us max=%lu us\r\n",
+			(unsigned long)baud, chunk, gap,
+			(unsigned long)(elapsed ? (uint64_t)goodBytes * 1000000u / elapsed : 0),
+			(unsigned long)corrupt, (unsigned long)chunks, (unsigned long)timeouts, (unsigned long)chunks,
+			(unsigned long)benchLatency[chunks * 50 / 100], (unsigned long)benchLatency[chunks * 90 / 100],
+			(unsigned long)benchLatency[chunks * 99 / 100], (unsigned long)benchLatency[chunks - 1]);
+}
+
+void runLinkBenchmark(void) {
+	HAL_NVIC_SetPriority(USART1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(USART1_IRQn);
+
+	printf("\r\n=== Link Benchmark (loopback PA9->PA10) ===\r\n");
+	for (size_t b = 0; b < sizeof(BENCH_BAUDS) / sizeof(BENCH_BAUDS[0]); b++) {
+		huart1.Init.BaudRate = BENCH_BAUDS[b];
+		if (HAL_UART_Init(&huart1) != HAL_OK) {
+			printf("baud=%lu init failed\r\n", (unsigned long)BENCH_BAUDS[b]);
+			continue;
+		}
+		for (size_t c = 0; c < sizeof(BENCH_CHUNKS) / sizeof(BENCH_CHUNKS[0]); c++) {
+			for (size_t g = 0; g < sizeof(BENCH_GAPS) / sizeof(BENCH_GAPS[0]); g++) {
+				benchRun(BENCH_BAUDS[b], BENCH_CHUNKS[c], BENCH_GAPS[g]);
+			}
+		}
+	}
+	printf("=== Benchmark complete ===\r\n");
+
+	// Back to the deployment baud rate
+	huart1.Init.BaudRate = 115200;
+	HAL_UART_Init(&huart1);
+}
+
 /* Keypad Initialization */
 void Keypad_Init(void) {
 	GPIO_InitTypeDef GPIO_InitStruct = {0};
@@ -141,7 +759,7 @@ static void HD44780_Write_Cmd(uint8_t cmd) {
 	data_t[1] = data_u | 0x08;  // en=0, rs=0
 	data_t[2] = data_l | 0x0C;  // en=1, rs=0
 	data_t[3] = data_l | 0x08;  // en=0, rs=0
-	HAL_I2C_Master_Transmit(&hi2c1, LCD_ADDR, (uint8_t)data_t, 4, 100);
+	HAL_I2C_Master_Transmit(&hi2c1, LCD_ADDR, (uint8_t*)data_t, 4, 100);
 }
 
 static void HD44780_Write_Data(uint8_t data) {
@@ -276,20 +894,31 @@ void deriveKeyFromAccessKey(const uint8_t* access_key, uint32_t timestamp, uint8
 	}
 }
 
-void decryptData(uint8_t* data, size_t length, const uint8_t* key) {
-	uint8_t keyStream[KEY_SIZE];
-	memcpy(keyStream, key, KEY_SIZE);
+void decryptInit(DecryptStream* stream, const uint8_t* key) {
+	memcpy(stream->key, key, KEY_SIZE);
+	memcpy(stream->keyStream, key, KEY_SIZE);
+	stream->position = 0;
+}
 
-	for(size_t i = 0; i < length; i++) {
+/* Decrypt the next length bytes of the stream in place */
+void decryptUpdate(DecryptStream* stream, uint8_t* data, size_t length) {
+	for(size_t n = 0; n < length; n++) {
+		size_t i = stream->position++;
 		if(i > 0 && (i % KEY_SIZE) == 0) {
 			for(int j = 0; j < KEY_SIZE; j++) {
-				keyStream[j] = keyStream[j] ^ key[j] ^ (i & 0xFF);
+				stream->keyStream[j] = stream->keyStream[j] ^ stream->key[j] ^ (i & 0xFF);
 			}
 		}
-		data[i] ^= keyStream[i % KEY_SIZE];
+		data[n] ^= stream->keyStream[i % KEY_SIZE];
 	}
 }
 
+void decryptData(uint8_t* data, size_t length, const uint8_t* key) {
+	DecryptStream stream;
+	decryptInit(&stream, key);
+	decryptUpdate(&stream, data, length);
+}
+
 /* LCD Display Function */
 void displayTextOnLCD(const char* text, size_t length) {
 	char line_buffer[LCD_COLS + 1];
@@ -342,14 +971,32 @@ int main(void) {
 	SystemClock_Config();
 	MX_GPIO_Init();
 	MX_I2C1_Init();
-	MX_USART1_UART_Init();
+	Link_Init();
 	MX_USART2_UART_Init();
+	enableCycleCounter();
+	poolInit();
+#if ENABLE_CHANNEL_BONDING || RX_RING_ACTIVE
+	MX_DMA_Init();
+#endif
+#if ENABLE_CHANNEL_BONDING
+	MX_USART6_UART_Init();
+#endif
 
 	// Initialize LCD and Keypad
 	HD44780_Init(2);
 	HD44780_Clear();
 	Keypad_Init();
 
+#if ENABLE_LINK_BENCHMARK
+	HD44780_SetCursor(0,0);
+	HD44780_PrintStr("Link Benchmark");
+	runLinkBenchmark();
+	HD44780_Clear();
+#endif
+#if RX_RING_ACTIVE
+	// After the benchmark, which drives huart1 by interrupt
+	rxRingStart();
+#endif
 	HD44780_SetCursor(0,0);
 	HD44780_PrintStr("System Ready");
 	HAL_Delay(2000);
@@ -360,15 +1007,17 @@ int main(void) {
 	uint8_t *decrypted_data = NULL;
 	uint32_t received_timestamp = 0;
 	uint32_t received_data_size = 0;
+	PayloadCodec codec = {0};
 
 	while(1) {
 		uint8_t startMarker = 0;
 
 		// Wait for start marker
-		printf("Waiting for start marker (0xAA)...\r\n");
+		printf("Waiting for start marker (0xAA-0xAD, 0xBA-0xBD compressed)...\r\n");
 		do {
-			if(HAL_UART_Receive(&huart1, &startMarker, 1, 100) == HAL_OK) {
-				if(startMarker == 0xAA) {
+			if(Link_Receive(&startMarker, 1, 100) == HAL_OK) {
+				uint8_t kind = startMarker & ~COMPRESSED_MARKER_FLAG;
+				if(kind >= START_MARKER && kind <= BROADCAST_BATCH_START_MARKER) {
 					printf("Start marker received!\r\n");
 					break;
 				}
@@ -380,55 +1029,193 @@ int main(void) {
 		// Receive and store all data first
 		HAL_StatusTypeDef status;
 
-		// Get access key
-		printf("Receiving access key...\r\n");
+		bool compressed = (startMarker & COMPRESSED_MARKER_FLAG) != 0;
+		startMarker &= ~COMPRESSED_MARKER_FLAG;
+		bool broadcast = (startMarker == BROADCAST_START_MARKER || startMarker == BROADCAST_BATCH_START_MARKER);
+		bool batch = (startMarker == BATCH_START_MARKER || startMarker == BROADCAST_BATCH_START_MARKER);
+		bool addressed = true;
+		uint8_t wrappedKey[ACCESS_KEY_SIZE];
+
+		// Get access key, or find our envelope in a broadcast
 		memset(receivedAccessKey, 0, sizeof(receivedAccessKey));
-		status = UART_Receive_Safe(&huart1, receivedAccessKey, ACCESS_KEY_SIZE, 1000);
-		if(status != HAL_OK) {
-			printf("Failed to receive access key\r\n");
-			continue;
+		if(broadcast) {
+			printf("Receiving key envelopes...\r\n");
+			status = receiveEnvelopes(wrappedKey, &addressed);
+			if(status != HAL_OK) {
+				printf("Failed to receive key envelopes\r\n");
+				continue;
+			}
+		} else {
+			printf("Receiving access key...\r\n");
+			status = Link_Receive(receivedAccessKey, ACCESS_KEY_SIZE, 1000);
+			if(status != HAL_OK) {
+				printf("Failed to receive access key\r\n");
+				continue;
+			}
+			receivedAccessKey[ACCESS_KEY_SIZE] = '\0';
+			printf("Access key received: %s\r\n", receivedAccessKey);
 		}
-		receivedAccessKey[ACCESS_KEY_SIZE] = '\0';
-		printf("Access key received: %s\r\n", receivedAccessKey);
 
 		// Get timestamp
-		status = HAL_UART_Receive(&huart1, (uint8_t*)&received_timestamp, sizeof(received_timestamp), 1000);
+		status = Link_Receive((uint8_t*)&received_timestamp, sizeof(received_timestamp), 1000);
 		if(status != HAL_OK) {
 			printf("Note: Timestamp reception skipped\r\n");
 			received_timestamp = HAL_GetTick(); // Use current time as timestamp
 		}
 
-		// Get data size
-		status = HAL_UART_Receive(&huart1, (uint8_t*)&received_data_size, sizeof(received_data_size), 1000);
-		if(status != HAL_OK || received_data_size == 0 || received_data_size > MAX_DATA_SIZE) {
-			printf("Invalid data size\r\n");
+		if(broadcast && addressed) {
+			unwrapAccessKey(DEVICE_KEY, received_timestamp, wrappedKey, receivedAccessKey);
+			receivedAccessKey[ACCESS_KEY_SIZE] = '\0';
+			printf("Access key unwrapped: %s\r\n", receivedAccessKey);
+		}
+
+		// Get data size, or the message directory for a batch
+		if(batch) {
+			status = Link_Receive(&messageCount, 1, 1000);
+			if(status != HAL_OK || messageCount == 0 || messageCount > MAX_BATCH_MESSAGES) {
+				printf("Invalid batch directory\r\n");
+				continue;
+			}
+
+			received_data_size = 0;
+			for(int i = 0; i < messageCount && status == HAL_OK; i++) {
+				uint32_t size = 0;
+				status = Link_Receive((uint8_t*)&size, sizeof(size), 1000);
+				messages[i].offset = received_data_size;
+				messages[i].size = size;
+				// Checked before adding - the directory has no CRC and a sum could wrap
+				if(size == 0 || size > MAX_DATA_SIZE - received_data_size) {
+					status = HAL_ERROR;
+				} else {
+					received_data_size += size;
+				}
+			}
+			if(status != HAL_OK) {
+				printf("Invalid batch directory\r\n");
+				continue;
+			}
+			printf("Batch of %u messages, %lu bytes\r\n", messageCount, (unsigned long)received_data_size);
+		} else {
+			status = Link_Receive((uint8_t*)&received_data_size, sizeof(received_data_size), 1000);
+			if(status != HAL_OK || received_data_size == 0 || received_data_size > MAX_DATA_SIZE) {
+				printf("Invalid data size\r\n");
+				continue;
+			}
+			messageCount = 1;
+			messages[0].offset = 0;
+			messages[0].size = received_data_size;
+		}
+		for(int i = 0; i < messageCount; i++) {
+			messages[i].text_offset = messages[i].offset;
+			messages[i].text_size = messages[i].size;
+		}
+
+		// A compressed frame says how much text it inflates to, and from which dictionary
+		if(compressed) {
+			status = Link_Receive((uint8_t*)&codec, sizeof(codec), 1000);
+			if(status != HAL_OK || codec.text_size == 0 || codec.text_size > MAX_DATA_SIZE) {
+				printf("Invalid codec field\r\n");
+				continue;
+			}
+			printf("Compressed payload, %lu text bytes\r\n", (unsigned long)codec.text_size);
+		}
+
+		// Frames for other decoders are skipped without being stored
+		if(!addressed) {
+			printf("Broadcast not addressed to 0x%02X, skipping %lu bytes\r\n",
+					DECODER_ADDRESS, (unsigned long)received_data_size);
+			drainFrame(received_data_size + 1);
+			continue;
+		}
+
+		if(compressed && codec.dictionary != PAYLOAD_DICT_CRC) {
+			printf("Payload dictionary %08lX, ours is %08lX - rebuild both boards, skipping frame\r\n",
+					(unsigned long)codec.dictionary, (unsigned long)PAYLOAD_DICT_CRC);
+			drainFrame(received_data_size + 1);
+			sendLinkStatus(broadcast, LINK_NAK);
 			continue;
 		}
 
-		// Allocate memory for encrypted data
-		decrypted_data = malloc(received_data_size + 1);
+		// Allocate memory for encrypted data, and for the text it inflates to
+		decrypted_data = poolAlloc(received_data_size + 1);
+		rxText = decrypted_data;
+		rxInflate.active = false;
+		if(decrypted_data != NULL && compressed) {
+			uint8_t* text = poolAlloc(codec.text_size + 1);
+			if(text == NULL) {
+				poolFree(decrypted_data);
+				decrypted_data = NULL;
+			} else {
+				inflateInit(text, codec.text_size);
+			}
+		}
 		if(decrypted_data == NULL) {
-			printf("Memory allocation failed\r\n");
+			printf("No pool block for %lu bytes, skipping frame\r\n", (unsigned long)received_data_size);
+			drainFrame(received_data_size + 1);
+			sendLinkStatus(broadcast, LINK_NAK);
 			continue;
 		}
 
+		// The key is known from the header, so the payload can be decrypted as it lands.
+		// The keypad still gates whether the plaintext is shown.
+		deriveKeyFromAccessKey(receivedAccessKey, received_timestamp, decryption_key);
+		decryptInit(&rxCipher, decryption_key);
+		rxPayload = decrypted_data;
+
 		// Receive encrypted data
+#if ENABLE_CHANNEL_BONDING
+		status = receiveBonded(decrypted_data, received_data_size);
+		if(status != HAL_OK) {
+			printf("Bonded receive failed\r\n");
+			releaseFrame(decrypted_data);
+			continue;
+		}
+#else
 		size_t received = 0;
 		while(received < received_data_size) {
 			uint16_t chunk_size = (received_data_size - received > 32) ? 32 : received_data_size - received;
-			status = HAL_UART_Receive(&huart1, &decrypted_data[received], chunk_size, 1000);
+			status = Link_Receive(&decrypted_data[received], chunk_size, 1000);
 			if(status != HAL_OK) break;
 			received += chunk_size;
+#if ENABLE_DECRYPT_ON_RECEIVE
+			decryptReceived(received);
+#endif
 		}
+#endif
 
 		// Get end marker
 		uint8_t endMarker;
-		status = HAL_UART_Receive(&huart1, &endMarker, 1, 1000);
-		if(status != HAL_OK || endMarker != 0x55) {
+		status = Link_Receive(&endMarker, 1, 1000);
+		if(status != HAL_OK || endMarker != END_MARKER) {
 			printf("Invalid end marker\r\n");
-			free(decrypted_data);
+			sendLinkStatus(broadcast, LINK_NAK);
+			releaseFrame(decrypted_data);
 			continue;
 		}
+		sendLinkStatus(broadcast, LINK_ACK);
+
+		uint32_t endMarkerCycles = DWT->CYCCNT;
+		decryptReceived(received_data_size);
+		decrypted_data[received_data_size] = '\0';
+		printf("End marker to plaintext: %lu us (%s%s)\r\n",
+				(unsigned long)((DWT->CYCCNT - endMarkerCycles) / (SystemCoreClock / 1000000u)),
+				ENABLE_DECRYPT_ON_RECEIVE ? "decrypt on receive" : "decrypt after receive",
+				rxInflate.active ? ", inflate" : "");
+		if(rxInflate.active) {
+			if(rxInflate.error || rxInflate.message < messageCount || rxInflate.out_pos != codec.text_size) {
+				printf("Corrupt compressed payload, dropping frame\r\n");
+				releaseFrame(decrypted_data);
+				continue;
+			}
+			rxText[rxInflate.out_pos] = '\0';
+			printf("Inflated %lu payload bytes to %lu text bytes\r\n",
+					(unsigned long)received_data_size, (unsigned long)rxInflate.out_pos);
+		}
+#if RX_RING_ACTIVE
+		if(rxDropped) {
+			printf("Receive ring dropped %lu bytes so far\r\n", (unsigned long)rxDropped);
+		}
+#endif
 
 		// Now prompt for keypad input
 		HD44780_Clear();
@@ -442,21 +1229,19 @@ int main(void) {
 			if(ProcessKeypadInput()) {
 				key_verified = true;
 
-				// Decrypt data
-				uint8_t decryption_key[KEY_SIZE];
-				deriveKeyFromAccessKey(receivedAccessKey, received_timestamp, decryption_key);
-				decryptData(decrypted_data, received_data_size, decryption_key);
-				decrypted_data[received_data_size] = '\0';
+				// Display each message of the frame in turn
+				for(int i = 0; i < messageCount; i++) {
+					char *text = (char*)&rxText[messages[i].text_offset];
 
-				// Display decrypted text
-				printf("\r\n=== Decrypted Text ===\r\n%s\r\n===================\r\n",
-						(char*)decrypted_data);
+					printf("\r\n=== Decrypted Text (%d of %u) ===\r\n%.*s\r\n===================\r\n",
+							i + 1, messageCount, (int)messages[i].text_size, text);
 
-				// Show on LCD
-				displayTextOnLCD((char*)decrypted_data, received_data_size);
+					// Show on LCD
+					displayTextOnLCD(text, messages[i].text_size);
+				}
 
 				// Clean up
-				free(decrypted_data);
+				releaseFrame(decrypted_data);
 				decrypted_data = NULL;
 				break;
 			}
@@ -469,18 +1254,20 @@ int main(void) {
 		HD44780_PrintStr("Ready for");
 		HD44780_SetCursor(0,1);
 		HD44780_PrintStr("next message");
+		poolReport();
 		printf("\r\nReady for next transmission\r\n");
 	}
 }
 
 /* Peripheral Initialization Functions */
+#if LINK_TRANSPORT == TRANSPORT_UART
 static void MX_USART1_UART_Init(void) {
 	huart1.Instance = USART1;
 	huart1.Init.BaudRate = 115200;
 	huart1.Init.WordLength = UART_WORDLENGTH_8B;
 	huart1.Init.StopBits = UART_STOPBITS_1;
 	huart1.Init.Parity = UART_PARITY_NONE;
-	huart1.Init.Mode = UART_MODE_RX;
+	huart1.Init.Mode = UART_MODE_TX_RX;  // TX returns the link status
 	huart1.Init.HwFlowCtl = UART_HWCONTROL_NONE;
 	huart1.Init.OverSampling = UART_OVERSAMPLING_16;
 
@@ -488,6 +1275,7 @@ static void MX_USART1_UART_Init(void) {
 		Error_Handler();
 	}
 }
+#endif
 
 static void MX_USART2_UART_Init(void) {
 	huart2.Instance = USART2;
@@ -504,6 +1292,156 @@ static void MX_USART2_UART_Init(void) {
 	}
 }
 
+#if ENABLE_CHANNEL_BONDING
+/* USART6 Initialization Function - second bonded port, RX on PC7 */
+static void MX_USART6_UART_Init(void) {
+	__HAL_RCC_USART6_CLK_ENABLE();
+
+	huart6.Instance = USART6;
+	huart6.Init.BaudRate = 115200;
+	huart6.Init.WordLength = UART_WORDLENGTH_8B;
+	huart6.Init.StopBits = UART_STOPBITS_1;
+	huart6.Init.Parity = UART_PARITY_NONE;
+	huart6.Init.Mode = UART_MODE_RX;
+	huart6.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+	huart6.Init.OverSampling = UART_OVERSAMPLING_16;
+
+	if (HAL_UART_Init(&huart6) != HAL_OK) {
+		Error_Handler();
+	}
+
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	__HAL_RCC_GPIOC_CLK_ENABLE();
+	GPIO_InitStruct.Pin = GPIO_PIN_7;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+	GPIO_InitStruct.Alternate = GPIO_AF8_USART6;
+	HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+
+	HAL_NVIC_SetPriority(USART6_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(USART6_IRQn);
+}
+#endif
+
+#if LINK_TRANSPORT == TRANSPORT_SPI
+/* SPI1 Initialization Function - transport slave, SCK/MISO/MOSI on PA5/PA6/PA7.
+ * NSS is soft so the slave is always selected on the point-to-point link.
+ * RX runs on DMA2 Stream0 channel 3. */
+static void MX_SPI1_Init(void) {
+	__HAL_RCC_SPI1_CLK_ENABLE();
+	__HAL_RCC_DMA2_CLK_ENABLE();
+
+	hspi1.Instance = SPI1;
+	hspi1.Init.Mode = SPI_MODE_SLAVE;
+	hspi1.Init.Direction = SPI_DIRECTION_2LINES;
+	hspi1.Init.DataSize = SPI_DATASIZE_8BIT;
+	hspi1.Init.CLKPolarity = SPI_POLARITY_LOW;
+	hspi1.Init.CLKPhase = SPI_PHASE_1EDGE;
+	hspi1.Init.NSS = SPI_NSS_SOFT;
+	hspi1.Init.FirstBit = SPI_FIRSTBIT_MSB;
+	hspi1.Init.TIMode = SPI_TIMODE_DISABLE;
+	hspi1.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+	hspi1.Init.CRCPolynomial = 10;
+	if (HAL_SPI_Init(&hspi1) != HAL_OK) {
+		Error_Handler();
+	}
+
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	GPIO_InitStruct.Pin = GPIO_PIN_5|GPIO_PIN_6|GPIO_PIN_7;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+	GPIO_InitStruct.Alternate = GPIO_AF5_SPI1;
+	HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+	hdma_spi1_rx.Instance = DMA2_Stream0;
+	hdma_spi1_rx.Init.Channel = DMA_CHANNEL_3;
+	hdma_spi1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_spi1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_spi1_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_spi1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_spi1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_spi1_rx.Init.Mode = DMA_NORMAL;
+	hdma_spi1_rx.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+	hdma_spi1_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(&hdma_spi1_rx) != HAL_OK) {
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hspi1, hdmarx, hdma_spi1_rx);
+
+	HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+	HAL_NVIC_SetPriority(SPI1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(SPI1_IRQn);
+}
+#endif
+
+void DMA2_Stream0_IRQHandler(void) {
+	HAL_DMA_IRQHandler(&hdma_spi1_rx);
+}
+
+void SPI1_IRQHandler(void) {
+	HAL_SPI_IRQHandler(&hspi1);
+}
+
+#if ENABLE_CHANNEL_BONDING || RX_RING_ACTIVE
+/* Configure one peripheral-to-memory DMA stream and link it to a UART */
+static void linkRxDMA(UART_HandleTypeDef* huart, DMA_HandleTypeDef* hdma,
+		DMA_Stream_TypeDef* stream, uint32_t channel, uint32_t mode) {
+	hdma->Instance = stream;
+	hdma->Init.Channel = channel;
+	hdma->Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma->Init.MemInc = DMA_MINC_ENABLE;
+	hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma->Init.Mode = mode;
+	hdma->Init.Priority = DMA_PRIORITY_HIGH;
+	hdma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(hdma) != HAL_OK) {
+		Error_Handler();
+	}
+	__HAL_LINKDMA(huart, hdmarx, *hdma);
+}
+
+/* DMA Initialization - USART1_RX is DMA2 Stream2 channel 4 (circular for the receive ring),
+ * USART6_RX is DMA2 Stream1 channel 5 */
+static void MX_DMA_Init(void) {
+	__HAL_RCC_DMA2_CLK_ENABLE();
+
+	linkRxDMA(&huart1, &hdma_usart1_rx, DMA2_Stream2, DMA_CHANNEL_4,
+			RX_RING_ACTIVE ? DMA_CIRCULAR : DMA_NORMAL);
+	HAL_NVIC_SetPriority(DMA2_Stream2_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Stream2_IRQn);
+
+#if ENABLE_CHANNEL_BONDING
+	linkRxDMA(&huart6, &hdma_usart6_rx, DMA2_Stream1, DMA_CHANNEL_5, DMA_NORMAL);
+	HAL_NVIC_SetPriority(DMA2_Stream1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Stream1_IRQn);
+#endif
+	HAL_NVIC_SetPriority(USART1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(USART1_IRQn);
+}
+#endif
+
+/* Interrupt handlers for the DMA-driven ports */
+void DMA2_Stream2_IRQHandler(void) {
+	HAL_DMA_IRQHandler(&hdma_usart1_rx);
+}
+
+void DMA2_Stream1_IRQHandler(void) {
+	HAL_DMA_IRQHandler(&hdma_usart6_rx);
+}
+
+void USART1_IRQHandler(void) {
+	HAL_UART_IRQHandler(&huart1);
+}
+
+void USART6_IRQHandler(void) {
+	HAL_UART_IRQHandler(&huart6);
+}
+
 static void MX_I2C1_Init(void) {
 	hi2c1.Instance = I2C1;
 	hi2c1.Init.ClockSpeed = 100000;
@@ -528,7 +1466,7 @@ static void MX_GPIO_Init(void) {
 	__HAL_RCC_GPIOB_CLK_ENABLE();
 
 	/* Configure UART pins */
-	GPIO_InitStruct.Pin = GPIO_PIN_10;  // PA10 is RX for UART1
+	GPIO_InitStruct.Pin = GPIO_PIN_9|GPIO_PIN_10;  // PA9 is TX, PA10 is RX for UART1
 	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
 	GPIO_InitStruct.Pull = GPIO_PULLUP;
 	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
@@ -590,6 +1528,7 @@ void Error_Handler(void) {
 
 /* Printf Output via UART2 */
 int _write(int file, char *ptr, int len) {
+	(void)file;
 	HAL_UART_Transmit(&huart2, (uint8_t*)ptr, len, HAL_MAX_DELAY);
 	return len;
 }
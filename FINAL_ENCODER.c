@@ -13,24 +13,142 @@
 #include "string.h"
 #include "stdlib.h"
 #include "liquidcrystal_i2c.h"
+#define PAYLOAD_DICT_INDEX            // The encoder searches the dictionary, the decoder only reads it
+#include "payload_dictionary.h"       // Generated by tools/train_dictionary.py from content/
+#include "spsc_ring.h"                // Log ring, shared with tools/spsc_stress.c
+
+/* Link transport - chosen at build time, all carry the same frame format */
+#define TRANSPORT_UART 0     // huart1, blocking
+#define TRANSPORT_SPI 1      // SPI1 master with DMA, for boards mounted side by side
+#define TRANSPORT_HOSTSIM 2  // pty named by SECUREEDU_LINK, built with tools/hostsim - see hal_host.c
+#define LINK_TRANSPORT TRANSPORT_UART
+
+/* Content store - where the packed catalog is read from, chosen at build time */
+#define STORE_FLASH 0     // Linked in from content_catalog.h and read in place
+#define STORE_SPI_NOR 1   // pack_catalog.py --binary image on a SPI NOR on SPI2, CS on PB12
+#define STORE_SD 2        // The same image on an SD card, SDIO 4-bit
+#define STORE_HOSTFILE 3  // POSIX file named by SECUREEDU_CATALOG, for host testing
+#define CONTENT_STORE STORE_FLASH
+#define STORE_EXTERNAL (CONTENT_STORE != STORE_FLASH)
+
+#define STORE_CATALOG_ADDRESS 0    // Where the image starts on the device, page aligned
+#define STORE_PAGE_SIZE 512        // One SD block
+#define STORE_CACHE_PAGES 8        // LRU page cache in SRAM, external stores only
+#define ENABLE_STORE_READ_AHEAD 1  // Read the next page while a streamed one is decoded
+#define STORE_TIMEOUT 100          // ms for one page read
+
+#if STORE_EXTERNAL && STORE_CATALOG_ADDRESS % STORE_PAGE_SIZE
+#error "STORE_CATALOG_ADDRESS must be a multiple of STORE_PAGE_SIZE"
+#endif
+#if STORE_EXTERNAL && STORE_CACHE_PAGES < 4
+#error "The cache needs a page per pinned cursor, one being read and one to fetch into"
+#endif
+
+#if CONTENT_STORE == STORE_FLASH
+#include "content_catalog.h"  // Generated by tools/pack_catalog.py from content/
+#endif
+
+#if LINK_TRANSPORT == TRANSPORT_HOSTSIM || CONTENT_STORE == STORE_HOSTFILE
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 /* Constants */
-#define MAX_PARAGRAPHS 3
-#define MAX_SENTENCES 10
 #define AES_BLOCK_SIZE 16
 #define KEY_SIZE 16
 #define ACCESS_KEY_SIZE 8
 #define MAX_TEXT_SIZE 10240  // Maximum size for selected text
-#define TX_BUFFER_SIZE 1024  // Transmission buffer size
+#define DECODER_MAX_DATA_SIZE 10240  // MAX_DATA_SIZE in FINAL_DECODER.c - the largest payload or text it takes
+#define MAX_BATCH_SELECTIONS 8  // Selections queued into one frame train
+#define MAX_BATCH_BYTES (MAX_TEXT_SIZE < DECODER_MAX_DATA_SIZE ? MAX_TEXT_SIZE : DECODER_MAX_DATA_SIZE)
+#define ENABLE_BATCH_MODE 0     // Queue selections, idle ENTER sends the batch
+#define ENABLE_BROADCAST_MODE 0 // Multi-drop RS-485 bus with per-recipient key envelopes
+#define ENABLE_CHANNEL_BONDING 0 // Stripe payload chunks across huart1 and huart6
+
+/* Channel bonding */
+#define BOND_PORTS 2             // Must match the txChains table
+#define BOND_CHUNK_SIZE 64
+#define BOND_HEADER_SIZE 3       // Sequence number (LE16) + chunk length
+#define BOND_TX_TIMEOUT 1000     // ms a port may stay busy before it is declared failed
+
+#include "channel_bond.h"  // Wire format, shared with the decoder
+
+#if ENABLE_CHANNEL_BONDING && LINK_TRANSPORT != TRANSPORT_UART
+#error "Channel bonding requires the UART transport"
+#endif
+
+#define LINK_TIMEOUT 1000        // ms allowed for one link transfer
+
+/* Non-blocking UART transmit */
+#define ENABLE_DMA_TX 1          // huart1 sends segment chains by DMA, straight from their buffers
+#define TX_MAX_SEGMENTS 16       // Header fields plus a full batch directory
+#define ENABLE_PIPELINED_ENCRYPT 1 // Encrypt each chunk while the previous one is on the wire
+#define ENABLE_GATHER_ENCRYPT 1  // Encrypt single selections straight out of the flash catalog, no plaintext copy
+#define TX_STAGE_SLOTS (2 * BOND_PORTS) // Encrypted chunks in flight - a slot comes round again only once its port has moved on
+#define TX_STAGE_SIZE PACING_MAX_CHUNK  // Also covers BOND_CHUNK_SIZE
+#define ENABLE_PAYLOAD_COMPRESSION 1 // LZ77 against the shared dictionary before encryption
+#define DICT_MATCH_MIN 4         // Shortest match - must match MATCH_MIN in tools/train_dictionary.py
+#define DICT_CHAIN_LIMIT 16      // Hash chain entries tried per position
+#define COMPRESS_PIECE 128       // Text coded at a time, positions fit a byte
+
+/* Link status byte the decoder returns after each point-to-point frame */
+#define LINK_ACK 0x06
+#define LINK_NAK 0x15
+#define LINK_STATUS_TIMEOUT 2500 // ms - covers the decoder's own chunk and end marker timeouts
+
+/* Adaptive pacing - AIMD on chunk size and inter-chunk gap */
+#define PACING_INITIAL_CHUNK 16
+#define PACING_INITIAL_GAP 10    // ms
+#define PACING_MIN_CHUNK 8
+#define PACING_MAX_CHUNK 256
+#define PACING_CHUNK_STEP 16     // Additive increase per clean frame
+#define PACING_MAX_GAP 80        // ms
+#define PACING_GAP_STEP 2        // ms, additive decrease per clean frame
+#define PACING_HISTORY 16        // Frames kept for the debug report
+
+/* Loopback link benchmark */
+#define ENABLE_LINK_BENCHMARK 0  // Run the PA9->PA10 loopback sweep at boot
+#define BENCH_BYTES_PER_RUN 4096
+#define BENCH_MAX_CHUNKS (BENCH_BYTES_PER_RUN / 16)
+#define BENCH_RX_SLACK_US 20000  // Added to the expected wire time before a chunk times out
+
+/* Frame markers */
+#define START_MARKER 0xAA
+#define BATCH_START_MARKER 0xAB
+#define BROADCAST_START_MARKER 0xAC
+#define BROADCAST_BATCH_START_MARKER 0xAD
+#define COMPRESSED_MARKER_FLAG 0x10  // Or'd into any start marker - payload is dictionary compressed
+#define END_MARKER 0x55
+
+/* Debug log - printf is queued and drained on huart2 by DMA */
+#define LOG_RING_SIZE 2048  // Must be a power of two
+#define LOG_FULL_WAIT_MS 20  // Longest printf waits on a full ring before dropping the rest
+
+/* RS-485 driver enable (broadcast mode) */
+#define RS485_DE_PORT GPIOA
+#define RS485_DE_PIN GPIO_PIN_8
 
 /* Private variables ---------------------------------------------------------*/
 I2C_HandleTypeDef hi2c1;
 UART_HandleTypeDef huart2;  // Keep for debug output
 UART_HandleTypeDef huart1;  // Add for transmission to decoder
-
-static uint8_t text_buffer[MAX_TEXT_SIZE];
-static uint8_t encrypted_buffer[MAX_TEXT_SIZE];
-static uint8_t tx_buffer[TX_BUFFER_SIZE];
+UART_HandleTypeDef huart6;  // Second bonded port
+DMA_HandleTypeDef hdma_usart1_tx;
+DMA_HandleTypeDef hdma_usart6_tx;
+DMA_HandleTypeDef hdma_usart2_tx;
+SPI_HandleTypeDef hspi1;    // SPI transport to decoder
+DMA_HandleTypeDef hdma_spi1_tx;
+#if CONTENT_STORE == STORE_SPI_NOR
+SPI_HandleTypeDef hspi2;    // External content store
+DMA_HandleTypeDef hdma_spi2_rx;
+DMA_HandleTypeDef hdma_spi2_tx;
+#elif CONTENT_STORE == STORE_SD
+SD_HandleTypeDef hsd;       // External content store
+#endif
+
+/* The one message buffer - the selection is copied in, padded and encrypted in place */
+static uint8_t message_buffer[MAX_TEXT_SIZE];
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
@@ -38,7 +156,21 @@ static void MX_GPIO_Init(void);
 static void MX_USART2_UART_Init(void);
 static void MX_I2C1_Init(void);
 void Error_Handler(void);
+#if LINK_TRANSPORT == TRANSPORT_UART
 static void MX_USART1_UART_Init(void);
+#endif
+#if ENABLE_CHANNEL_BONDING
+static void MX_USART6_UART_Init(void);
+#endif
+static void MX_DMA_Init(void);
+#if LINK_TRANSPORT == TRANSPORT_SPI
+static void MX_SPI1_Init(void);
+#endif
+#if CONTENT_STORE == STORE_SPI_NOR
+static void MX_SPI2_Init(void);
+#elif CONTENT_STORE == STORE_SD
+static void MX_SDIO_SD_Init(void);
+#endif
 
 /* Encryption structures and variables */
 typedef struct {
@@ -50,24 +182,532 @@ typedef struct {
 
 static EncryptionInfo encInfo = {0};
 
+/* Broadcast recipients - each decoder is provisioned with its address and device key */
+typedef struct {
+	uint8_t address;
+	uint8_t device_key[KEY_SIZE];
+} Recipient;
+
+static const Recipient RECIPIENTS[] = {
+		{0x01, {0x3B, 0x91, 0x5E, 0x07, 0xC4, 0x28, 0xA6, 0x7D, 0x12, 0xE9, 0x40, 0xB3, 0x6F, 0x85, 0x1C, 0xD2}},
+		{0x02, {0x8A, 0x24, 0xF0, 0x6B, 0x19, 0xD7, 0x53, 0xAE, 0x35, 0x7C, 0xC1, 0x0E, 0x92, 0x4F, 0xE8, 0x66}},
+		{0x03, {0xD5, 0x0A, 0x87, 0x31, 0xBC, 0x64, 0x1F, 0xF9, 0x4E, 0xA2, 0x78, 0x13, 0xCD, 0x59, 0x06, 0x9B}}
+};
+
+#define NUM_RECIPIENTS (sizeof(RECIPIENTS) / sizeof(RECIPIENTS[0]))
+#define ENVELOPE_SIZE (1 + ACCESS_KEY_SIZE)  // Address + wrapped access key
+
+/* Content Store */
+/* The catalog is read through a StoreCursor, which maps a run of bytes at a
+ * catalog address. Internal flash is mapped in place. External stores go
+ * through an LRU cache of STORE_PAGE_SIZE pages: the page a cursor streams
+ * from is pinned, and the page after it is read ahead while it is decoded.
+ * The device has one read outstanding at a time - SPI NOR by DMA, SD by
+ * interrupt. Index lookups copy out of the cache and never read ahead. */
+typedef struct {
+	uint32_t address;     // Next byte, from the start of the catalog
+	const uint8_t* data;  // Where it is mapped
+	uint32_t avail;       // Bytes mapped from there on
+	uint8_t pinned;       // Cache slot + 1 holding the page, 0 if none
+} StoreCursor;
+
+#if STORE_EXTERNAL
+#define STORE_NO_PAGE 0xFFFFFFFFu
+
+typedef struct {
+	uint32_t page;      // STORE_NO_PAGE if empty
+	uint32_t last_use;  // LRU stamp
+	uint8_t pins;       // Cursors mapped into it - never evicted while set
+	uint8_t ahead;      // Read ahead and not used yet
+} StoreSlot;
+
+typedef struct {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t ahead_reads;   // Pages read ahead
+	uint32_t ahead_hits;    // Of those, used before being evicted
+	uint32_t stall_cycles;  // Waiting on the device
+	uint32_t device_bytes;
+} StoreStats;
+
+static uint8_t storeCache[STORE_CACHE_PAGES][STORE_PAGE_SIZE] __attribute__((aligned(4)));
+static StoreSlot storeSlots[STORE_CACHE_PAGES];
+static uint32_t storeClock = 0;
+static int storeInFlight = -1;          // Slot the device is filling
+static volatile uint8_t storeDone = 0;
+static volatile uint8_t storeFailed = 0;
+static uint32_t storeEnd = 0;           // End of the catalog image - nothing is read ahead past it
+static StoreStats storeStats;
+
+#if CONTENT_STORE == STORE_SPI_NOR
+#define NOR_CS_PORT GPIOB
+#define NOR_CS_PIN GPIO_PIN_12
+#define NOR_READ 0x03       // Plain read, no dummy cycles - good to 50 MHz on common parts
+#define NOR_JEDEC_ID 0x9F
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) {
+	if (hspi == &hspi2) {
+		HAL_GPIO_WritePin(NOR_CS_PORT, NOR_CS_PIN, GPIO_PIN_SET);
+		storeDone = 1;
+	}
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+	if (hspi == &hspi2) {
+		HAL_GPIO_WritePin(NOR_CS_PORT, NOR_CS_PIN, GPIO_PIN_SET);
+		storeFailed = 1;
+		storeDone = 1;
+	}
+}
+#elif CONTENT_STORE == STORE_SD
+void HAL_SD_RxCpltCallback(SD_HandleTypeDef *sd) {
+	storeDone = 1;
+}
+
+void HAL_SD_ErrorCallback(SD_HandleTypeDef *sd) {
+	storeFailed = 1;
+	storeDone = 1;
+}
+#else
+static int storeFile = -1;
+#endif
+
+/* Start reading page into dest; storeDone is set once it is in */
+static HAL_StatusTypeDef storeDeviceRead(uint32_t page, uint8_t* dest) {
+	uint32_t address = STORE_CATALOG_ADDRESS + page * STORE_PAGE_SIZE;
+	storeDone = 0;
+	storeFailed = 0;
+#if CONTENT_STORE == STORE_SPI_NOR
+	uint8_t command[4] = {NOR_READ, (uint8_t)(address >> 16), (uint8_t)(address >> 8), (uint8_t)address};
+	HAL_GPIO_WritePin(NOR_CS_PORT, NOR_CS_PIN, GPIO_PIN_RESET);
+	if (HAL_SPI_Transmit(&hspi2, command, sizeof(command), STORE_TIMEOUT) != HAL_OK ||
+			HAL_SPI_Receive_DMA(&hspi2, dest, STORE_PAGE_SIZE) != HAL_OK) {
+		HAL_GPIO_WritePin(NOR_CS_PORT, NOR_CS_PIN, GPIO_PIN_SET);
+		return HAL_ERROR;
+	}
+	return HAL_OK;
+#elif CONTENT_STORE == STORE_SD
+	return HAL_SD_ReadBlocks_IT(&hsd, dest, address / STORE_PAGE_SIZE, 1);
+#else
+	ssize_t n = pread(storeFile, dest, STORE_PAGE_SIZE, address);
+	if (n < 0) {
+		return HAL_ERROR;
+	}
+	memset(dest + n, 0, STORE_PAGE_SIZE - n);  // Past the end of the image
+	storeDone = 1;
+	return HAL_OK;
+#endif
+}
+
+/* Wait for the page in flight, if any. The catalog is unusable without its
+ * store, so a failed or stuck read halts. */
+static void storeWait(void) {
+	if (storeInFlight < 0) {
+		return;
+	}
+	uint32_t start = DWT->CYCCNT;
+	uint32_t tick = HAL_GetTick();
+	while (!storeDone && HAL_GetTick() - tick < STORE_TIMEOUT) {
+	}
+#if CONTENT_STORE == STORE_SD
+	while (storeDone && HAL_SD_GetCardState(&hsd) != HAL_SD_CARD_TRANSFER &&
+			HAL_GetTick() - tick < STORE_TIMEOUT) {
+	}
+#endif
+	if (!storeDone || storeFailed) {
+		printf("Content store read of page %lu failed\r\n", (unsigned long)storeSlots[storeInFlight].page);
+		Error_Handler();
+	}
+	storeStats.stall_cycles += DWT->CYCCNT - start;
+	storeInFlight = -1;
+}
+
+/* Least recently used slot that is neither pinned nor being filled */
+static int storeVictim(void) {
+	int victim = -1;
+	for (int i = 0; i < STORE_CACHE_PAGES; i++) {
+		if (storeSlots[i].pins == 0 && i != storeInFlight &&
+				(victim < 0 || storeSlots[i].last_use < storeSlots[victim].last_use)) {
+			victim = i;
+		}
+	}
+	return victim;  // Always one - see the STORE_CACHE_PAGES check at the top
+}
+
+static int storeFind(uint32_t page) {
+	for (int i = 0; i < STORE_CACHE_PAGES; i++) {
+		if (storeSlots[i].page == page) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void storeLoad(int slot, uint32_t page, uint8_t ahead) {
+	storeSlots[slot].page = page;
+	storeSlots[slot].ahead = ahead;
+	storeSlots[slot].last_use = storeClock;
+	storeInFlight = slot;
+	storeStats.device_bytes += STORE_PAGE_SIZE;
+	if (storeDeviceRead(page, storeCache[slot]) != HAL_OK) {
+		storeDone = 1;
+		storeFailed = 1;
+		storeWait();
+	}
+}
+
+/* Slot holding page, read in if need be. A streamed page is pinned for the
+ * cursor and the next one started, so it is in by the time the cursor gets
+ * there. */
+static int storeFetch(uint32_t page, uint8_t stream) {
+	if (storeDone) {
+		storeWait();  // Retire a finished read so the next can start
+	}
+	int slot = storeFind(page);
+	storeClock++;
+	if (slot >= 0) {
+		if (slot == storeInFlight) {
+			storeWait();
+		}
+		storeStats.hits++;
+		if (storeSlots[slot].ahead) {
+			storeSlots[slot].ahead = 0;
+			storeStats.ahead_hits++;
+		}
+	} else {
+		storeWait();
+		slot = storeVictim();
+		storeStats.misses++;
+		storeLoad(slot, page, 0);
+		storeWait();
+	}
+	storeSlots[slot].last_use = storeClock;
+	if (!stream) {
+		return slot;
+	}
+	storeSlots[slot].pins++;
+
+#if ENABLE_STORE_READ_AHEAD
+	uint32_t next = page + 1;
+	if (storeInFlight < 0 && next * STORE_PAGE_SIZE < storeEnd && storeFind(next) < 0) {
+		storeStats.ahead_reads++;
+		storeLoad(storeVictim(), next, 1);
+	}
+#endif
+	return slot;
+}
+#endif
+
+/* Bring up the store the catalog is read from */
+static void storeInit(void) {
+#if CONTENT_STORE == STORE_SPI_NOR
+	MX_SPI2_Init();
+	uint8_t command[4] = {NOR_JEDEC_ID, 0, 0, 0};
+	uint8_t id[4] = {0};
+	HAL_GPIO_WritePin(NOR_CS_PORT, NOR_CS_PIN, GPIO_PIN_RESET);
+	HAL_SPI_TransmitReceive(&hspi2, command, id, sizeof(command), STORE_TIMEOUT);
+	HAL_GPIO_WritePin(NOR_CS_PORT, NOR_CS_PIN, GPIO_PIN_SET);
+	if (id[1] == 0x00 || id[1] == 0xFF) {
+		printf("No SPI NOR answering on SPI2\r\n");
+		Error_Handler();
+	}
+	printf("Content store: SPI NOR, JEDEC ID %02X %02X %02X\r\n", id[1], id[2], id[3]);
+#elif CONTENT_STORE == STORE_SD
+	MX_SDIO_SD_Init();
+	printf("Content store: SD card, %lu blocks\r\n", (unsigned long)hsd.SdCard.BlockNbr);
+#elif CONTENT_STORE == STORE_HOSTFILE
+	const char* path = getenv("SECUREEDU_CATALOG");
+	storeFile = path ? open(path, O_RDONLY) : -1;
+	if (storeFile < 0) {
+		printf("Set SECUREEDU_CATALOG to a pack_catalog.py --binary image\r\n");
+		Error_Handler();
+	}
+#endif
+#if STORE_EXTERNAL
+	for (int i = 0; i < STORE_CACHE_PAGES; i++) {
+		storeSlots[i].page = STORE_NO_PAGE;
+	}
+	storeEnd = 0xFFFFFFFFu;  // Until catalogCheck knows the catalog's size
+#endif
+}
+
+/* Point a cursor at address, releasing the page it had pinned */
+static void cursorSeek(StoreCursor* cursor, uint32_t address) {
+#if STORE_EXTERNAL
+	if (cursor->pinned) {
+		storeSlots[cursor->pinned - 1].pins--;
+		cursor->pinned = 0;
+	}
+#endif
+	cursor->address = address;
+	cursor->avail = 0;
+}
+
+/* Map the bytes from the cursor's address on */
+static void cursorMap(StoreCursor* cursor) {
+#if STORE_EXTERNAL
+	uint32_t offset = cursor->address % STORE_PAGE_SIZE;
+	cursorSeek(cursor, cursor->address);
+	int slot = storeFetch(cursor->address / STORE_PAGE_SIZE, 1);
+	cursor->pinned = (uint8_t)(slot + 1);
+	cursor->data = &storeCache[slot][offset];
+	cursor->avail = STORE_PAGE_SIZE - offset;
+#else
+	cursor->data = &CONTENT_CATALOG[cursor->address];
+	cursor->avail = sizeof(CONTENT_CATALOG) - cursor->address;
+#endif
+}
+
+static uint8_t cursorByte(StoreCursor* cursor) {
+	if (cursor->avail == 0) {
+		cursorMap(cursor);
+	}
+	cursor->address++;
+	cursor->avail--;
+	return *cursor->data++;
+}
+
+/* Copy length bytes to dest, or step over them if dest is NULL */
+static void cursorRead(StoreCursor* cursor, uint8_t* dest, size_t length) {
+	if (!dest && length > cursor->avail) {
+		cursorSeek(cursor, cursor->address + length);
+		return;
+	}
+	while (length > 0) {
+		if (cursor->avail == 0) {
+			cursorMap(cursor);
+		}
+		size_t n = length < cursor->avail ? length : cursor->avail;
+		if (dest) {
+			memcpy(dest, cursor->data, n);
+			dest += n;
+		}
+		cursor->data += n;
+		cursor->address += n;
+		cursor->avail -= n;
+		length -= n;
+	}
+}
+
+/* Random-access copy out of the store - nothing pinned, nothing read ahead */
+static void storeRead(uint32_t address, void* dest, size_t length) {
+#if STORE_EXTERNAL
+	uint8_t* out = dest;
+	while (length > 0) {
+		uint32_t offset = address % STORE_PAGE_SIZE;
+		size_t n = STORE_PAGE_SIZE - offset;
+		if (n > length) {
+			n = length;
+		}
+		memcpy(out, &storeCache[storeFetch(address / STORE_PAGE_SIZE, 0)][offset], n);
+		out += n;
+		address += n;
+		length -= n;
+	}
+#else
+	memcpy(dest, &CONTENT_CATALOG[address], length);
+#endif
+}
+
+/* Cache hit rate and device time since the last report */
+static void storeReport(void) {
+#if STORE_EXTERNAL
+	uint32_t lookups = storeStats.hits + storeStats.misses;
+	printf("Content store: %lu%% of %lu page lookups hit, %lu of %lu read-ahead pages used, "
+			"%lu KB read, %lu us stalled\r\n",
+			(unsigned long)(lookups ? storeStats.hits * 100u / lookups : 100u), (unsigned long)lookups,
+			(unsigned long)storeStats.ahead_hits, (unsigned long)storeStats.ahead_reads,
+			(unsigned long)(storeStats.device_bytes / 1024u),
+			(unsigned long)(storeStats.stall_cycles / (SystemCoreClock / 1000000u)));
+	memset(&storeStats, 0, sizeof(storeStats));
+#endif
+}
+
 /* Text Content */
-const char* PARAGRAPHS[MAX_PARAGRAPHS][MAX_SENTENCES] = {
-		{
-				"What is the derivative of 2x^3 + 3x?",
-				"The derivative is 6x^2 + 3.",
-				NULL
-		},
-		{
-				"What is the moment of inertia of a rolling disk?",
-				"I = 1/2MR^2.",
-				NULL
-		},
-		{
-				"When the determinant does not equal to 0, is the matrix invertible?",
-				"The matrix is indeed invertible if the det(A) != 0.",
-				NULL
+/* Paragraphs and lines live in the content catalog packed from content/ by
+ * tools/pack_catalog.py - see there for the layout and the block codec. The
+ * index makes any (paragraph, line) lookup O(1). Text may be stored LZ77
+ * compressed in independent blocks; CatalogReader streams it back out. The
+ * catalog is read through the content store, so only its header is kept in
+ * RAM. */
+#define CATALOG_MAGIC "CCAT"
+#define CATALOG_VERSION 2
+#define CATALOG_WINDOW 256  // Match distance limit - must match WINDOW_SIZE in the packer
+#define CATALOG_MATCH_MIN 3
+
+/* Followed in the store by u32 first[paragraphs + 1], offset[lines + 1],
+ * block[blocks + 1] if compressed, then the data */
+typedef struct {
+	char magic[4];
+	uint16_t version;
+	uint16_t paragraphs;
+	uint32_t lines;
+	uint16_t block_size;  // 0 for uncompressed text
+	uint16_t blocks;
+} CatalogHeader;
+
+static CatalogHeader catalogInfo;  // Read from the store by catalogCheck
+static const CatalogHeader* const catalog = &catalogInfo;
+
+/* Streaming read of the catalog text from any offset. Only the last
+ * CATALOG_WINDOW bytes are kept, whatever the caller does with its output. */
+typedef struct {
+	uint32_t pos;             // Offset in the uncompressed text
+	uint32_t block_end;       // Where the current block stops
+	StoreCursor in;           // Next stored byte
+	uint32_t literals;        // Left in the current sequence
+	uint32_t match;
+	uint8_t distance;         // Back reference - 1
+	uint8_t window[CATALOG_WINDOW];
+} CatalogReader;
+
+static CatalogReader textReader;  // Thread-context listings and copies; the gather has its own
+
+/* Word i of the index tables after the header */
+static uint32_t catalogWord(uint32_t i) {
+	uint32_t word;
+	storeRead(sizeof(CatalogHeader) + i * 4u, &word, sizeof(word));
+	return word;
+}
+
+/* Global number of paragraph p's first line; p == paragraphs gives the line count */
+static uint32_t catalogFirst(int p) {
+	return catalogWord(p);
+}
+
+/* Offset of global line n in the text; n == lines gives the text size */
+static uint32_t catalogOffset(uint32_t n) {
+	return catalogWord(catalog->paragraphs + 1 + n);
+}
+
+/* Length of global line n, without its terminator */
+static size_t catalogLength(uint32_t n) {
+	return catalogOffset(n + 1) - catalogOffset(n) - 1;
+}
+
+/* Whether paragraph p has a line l */
+static int catalogHasLine(int p, int l) {
+	return p >= 0 && p < catalog->paragraphs && l >= 0 &&
+			catalogFirst(p) + l < catalogFirst(p + 1);
+}
+
+/* Store address of the data area, and start of compressed block k within it */
+static uint32_t catalogData(void) {
+	uint32_t tables = catalog->paragraphs + 1 + catalog->lines + 1 +
+			(catalog->block_size ? catalog->blocks + 1 : 0);
+	return sizeof(CatalogHeader) + tables * 4u;
+}
+
+static uint32_t catalogBlock(uint32_t k) {
+	return catalogWord(catalog->paragraphs + 1 + catalog->lines + 1 + k);
+}
+
+/* Literal count or match code - a nibble of 15 continues in extension bytes */
+static uint32_t readerLength(CatalogReader* reader, uint32_t nibble) {
+	uint32_t length = nibble;
+	if (nibble == 15) {
+		uint8_t b;
+		do {
+			b = cursorByte(&reader->in);
+			length += b;
+		} while (b == 255);
+	}
+	return length;
+}
+
+/* Next sequence header, moving on to the next block at a block boundary */
+static void readerSequence(CatalogReader* reader) {
+	if (reader->pos == reader->block_end) {
+		uint32_t k = reader->pos / catalog->block_size;
+		uint32_t text_size = catalogOffset(catalog->lines);
+		uint32_t start = catalogData() + catalogBlock(k);
+		if (start != reader->in.address) {
+			cursorSeek(&reader->in, start);  // Blocks are back to back, so only on a jump
 		}
-};
+		reader->block_end = (text_size - reader->pos > catalog->block_size) ?
+				reader->pos + catalog->block_size : text_size;
+	}
+
+	uint8_t token = cursorByte(&reader->in);
+	reader->literals = readerLength(reader, token >> 4);
+	uint32_t code = readerLength(reader, token & 0x0F);
+	reader->match = code ? code + CATALOG_MATCH_MIN - 1 : 0;
+	if (reader->match) {
+		reader->distance = cursorByte(&reader->in);
+	}
+}
+
+/* Copy length bytes of text to dest, or just step over them if dest is NULL */
+static void catalogRead(CatalogReader* reader, uint8_t* dest, size_t length) {
+	if (catalog->block_size == 0) {
+		cursorRead(&reader->in, dest, length);
+		reader->pos += length;
+		return;
+	}
+
+	while (length > 0) {
+		uint8_t b;
+		if (reader->literals > 0) {
+			b = cursorByte(&reader->in);
+			reader->literals--;
+		} else if (reader->match > 0) {
+			b = reader->window[(reader->pos - reader->distance - 1) % CATALOG_WINDOW];
+			reader->match--;
+		} else {
+			readerSequence(reader);
+			continue;
+		}
+		reader->window[reader->pos % CATALOG_WINDOW] = b;
+		reader->pos++;
+		if (dest) {
+			*dest++ = b;
+		}
+		length--;
+	}
+}
+
+/* Position a reader at offset, decoding forward from the start of its block */
+static void catalogOpen(CatalogReader* reader, uint32_t offset) {
+	reader->literals = 0;
+	reader->match = 0;
+	if (catalog->block_size == 0) {
+		reader->pos = offset;
+		cursorSeek(&reader->in, catalogData() + offset);
+		return;
+	}
+	reader->pos = offset - offset % catalog->block_size;
+	reader->block_end = reader->pos;  // Loads the block on the first read
+	cursorSeek(&reader->in, 0xFFFFFFFFu);
+	catalogRead(reader, NULL, offset - reader->pos);
+}
+
+/* Halt on a catalog packed for another layout. Decoding the whole text once
+ * also gives the storage ratio and the read rate, device included. */
+static void catalogCheck(void) {
+	storeInit();
+	storeRead(0, &catalogInfo, sizeof(catalogInfo));
+	if (memcmp(catalog->magic, CATALOG_MAGIC, 4) != 0 || catalog->version != CATALOG_VERSION) {
+		printf("Content catalog missing or wrong version - rerun tools/pack_catalog.py\r\n");
+		Error_Handler();
+	}
+
+	uint32_t text_size = catalogOffset(catalog->lines);
+	uint32_t stored = catalog->block_size ? catalogBlock(catalog->blocks) : text_size;
+#if STORE_EXTERNAL
+	storeEnd = catalogData() + stored;
+#endif
+	uint32_t start = DWT->CYCCNT;
+	catalogOpen(&textReader, 0);
+	catalogRead(&textReader, NULL, text_size);
+	uint32_t us = (DWT->CYCCNT - start) / (SystemCoreClock / 1000000u);
+
+	printf("Content catalog: %u paragraphs, %lu lines, text %lu -> %lu bytes (%lu%%)\r\n",
+			catalog->paragraphs, (unsigned long)catalog->lines, (unsigned long)text_size,
+			(unsigned long)stored, (unsigned long)(text_size ? stored * 100u / text_size : 0));
+	printf("Catalog %s in %lu us (%lu KB/s)\r\n", catalog->block_size ? "decompressed" : "read",
+			(unsigned long)us, (unsigned long)(us ? (uint64_t)text_size * 1000u / 1024u / us : 0));
+	storeReport();
+}
 
 /* Selection State */
 typedef struct {
@@ -86,6 +726,216 @@ TextPosition endPos = {0, 0, 0};
 InputState currentState = INPUT_PARAGRAPH;
 TextPosition* currentPos = &startPos;
 
+/* Selection Range */
+/* A selection resolved to global catalog lines. Paragraphs are stored back to
+ * back, so any selection is one contiguous run of lines, and the catalog's
+ * offset table - a prefix sum of '\n'-terminated line lengths - sizes it
+ * without touching the text. */
+typedef struct {
+	uint32_t first;  // Global line numbers, inclusive
+	uint32_t last;
+	size_t length;   // Plaintext bytes, '\n' separators included
+	size_t padded;   // Rounded up to AES_BLOCK_SIZE
+} SelectionRange;
+
+#define RANGE_INVALID (-1)
+#define RANGE_TOO_LARGE (-2)
+
+/* Resolve start and end in O(1). Returns RANGE_INVALID if either lies outside
+ * the catalog or end comes before start, and RANGE_TOO_LARGE (with the range
+ * filled in) if the decoder could not take it. The gather lifts the encoder's
+ * own MAX_TEXT_SIZE limit but not the decoder's frame size. */
+static int rangeResolve(const TextPosition* start, const TextPosition* end, SelectionRange* range) {
+	if (!catalogHasLine(start->paragraph, start->line) ||
+			!catalogHasLine(end->paragraph, end->line)) {
+		return RANGE_INVALID;
+	}
+
+	range->first = catalogFirst(start->paragraph) + start->line;
+	range->last = catalogFirst(end->paragraph) + end->line;
+	if (range->last < range->first) {
+		return RANGE_INVALID;
+	}
+	range->length = catalogOffset(range->last + 1) - catalogOffset(range->first);
+	range->padded = ((range->length + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE) * AES_BLOCK_SIZE;
+	return range->padded > DECODER_MAX_DATA_SIZE ? RANGE_TOO_LARGE : 0;
+}
+
+/* Batch Queue */
+typedef struct {
+	TextPosition start;
+	TextPosition end;
+} BatchEntry;
+
+static BatchEntry batchQueue[MAX_BATCH_SELECTIONS];
+static uint32_t batchSizes[MAX_BATCH_SELECTIONS];
+static uint8_t batchCount = 0;
+static size_t batchBytes = 0;  // Padded bytes queued, kept within MAX_BATCH_BYTES
+
+/* Pacing controller state, one session per power cycle */
+typedef enum {
+	LINK_RESULT_OK,
+	LINK_RESULT_ERROR,    // Decoder NAK or local transmit failure
+	LINK_RESULT_TIMEOUT   // No status byte came back
+} LinkResult;
+
+typedef struct {
+	uint16_t chunk_size;
+	uint16_t gap_ms;
+	uint8_t result;
+} PacingSample;
+
+typedef struct {
+	uint16_t chunk_size;
+	uint16_t gap_ms;
+	uint32_t frames;
+	uint32_t errors;
+	uint32_t timeouts;
+	PacingSample history[PACING_HISTORY];
+	uint8_t history_head;
+} PacingController;
+
+static PacingController pacing = {.chunk_size = PACING_INITIAL_CHUNK, .gap_ms = PACING_INITIAL_GAP};
+
+/* Scatter-gather TX - a frame is a list of segments sent from where they live */
+typedef struct {
+	const uint8_t* data;
+	uint16_t length;
+} TxSegment;
+
+typedef struct {
+	TxSegment segments[TX_MAX_SEGMENTS];
+	uint8_t count;
+} TxFrame;
+
+/* A segment chain on one UART. The TX-complete interrupt starts the next
+ * segment, so the whole chain goes out without the CPU. */
+typedef struct {
+	UART_HandleTypeDef* huart;
+	TxSegment segments[TX_MAX_SEGMENTS];
+	uint8_t count;
+	volatile uint8_t next;
+	volatile uint8_t busy;
+	volatile uint8_t error;
+} TxChain;
+
+/* Chain 0 is the link; with bonding, chain k is bonded port k */
+static TxChain txChains[BOND_PORTS] = {{.huart = &huart1}, {.huart = &huart6}};
+
+/* Header fields without a home elsewhere. Segments point here, so they
+ * stay put until the chain has gone out. */
+static uint8_t txMarker;
+static uint8_t txEnvelopeCount;
+static uint8_t txEnvelopes[NUM_RECIPIENTS][ENVELOPE_SIZE];
+static const uint8_t txEndMarker = END_MARKER;
+
+/* TX CPU accounting - cycles the CPU sat waiting during a frame, by cause,
+ * versus the whole frame from start marker to link status */
+typedef struct {
+	uint32_t link;    // Blocking transfers and waits on a busy DMA chain
+	uint32_t pacing;  // Busy-waiting out the gap between chunks
+	uint32_t delays;  // Fixed settle delays between frame sections
+	uint32_t reply;   // Waiting for the decoder's link status
+} TxWaitCycles;
+
+static TxWaitCycles txWait = {0};
+static uint32_t txWindowStart = 0;
+
+/* Pipeline timing - cycle stamps for the request, and for the first frame byte handed to the link */
+static uint32_t txRequestStart = 0;
+static uint32_t txFirstByte = 0;
+
+/* Keystream state, so a buffer can be encrypted a piece at a time */
+typedef struct {
+	uint8_t keyStream[KEY_SIZE];
+	size_t position;
+} CipherStream;
+
+static CipherStream txCipher;
+static size_t txEncrypted = 0;  // Leading bytes of message_buffer already encrypted
+
+/* Selected lines read in place from flash as one '\n'-terminated,
+ * zero-padded plaintext stream */
+typedef struct {
+	CatalogReader reader;
+	size_t remaining;  // Text bytes left before the padding
+} TextGather;
+
+static uint8_t txGatherActive = 0;  // Payload comes from txGather instead of message_buffer
+#if ENABLE_GATHER_ENCRYPT
+static TextGather txGather;
+static uint8_t txStage[TX_STAGE_SLOTS][TX_STAGE_SIZE];
+#endif
+
+/* Compressed frames carry this in clear after the size or directory, so the
+ * decoder can size its text buffer and check it has the same dictionary */
+typedef struct {
+	uint32_t dictionary;  // PAYLOAD_DICT_CRC
+	uint32_t text_size;   // Plaintext bytes across all messages, unpadded
+} PayloadCodec;
+
+static uint8_t txCompressed = 0;  // message_buffer holds dictionary-compressed messages
+static PayloadCodec txCodec = {PAYLOAD_DICT_CRC, 0};
+#if ENABLE_PAYLOAD_COMPRESSION
+/* The piece of text being coded, with hash chains over its positions */
+typedef struct {
+	uint8_t text[COMPRESS_PIECE];
+	uint8_t head[1 << PAYLOAD_DICT_HASH_BITS];  // Latest position per hash, COMPRESS_NONE if none
+	uint8_t next[COMPRESS_PIECE];                // Previous position with the same hash
+} CompressPiece;
+
+#define COMPRESS_NONE 0xFF
+
+static CompressPiece compressPiece;
+#endif
+
+#if ENABLE_CHANNEL_BONDING
+/* Bonded ports - chunk k goes out on port k % BOND_PORTS, after its sequence header */
+static uint8_t bondTxHeader[BOND_PORTS][BOND_HEADER_SIZE];
+#endif
+
+/* Debug Log */
+SPSC_RING_STORAGE(logStorage, LOG_RING_SIZE);
+static SpscRing logRing;
+static volatile uint32_t logInFlight = 0;  // Bytes huart2 DMA is sending, 0 when idle
+static volatile uint32_t logErrors = 0;    // huart2 transfers abandoned on a UART or DMA error
+
+/* Start the next contiguous run if huart2 is idle. Called from the log
+ * path and from the DMA completion, so the idle check is done masked. */
+static void logKick(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (logInFlight == 0) {
+		uint8_t* run;
+		uint32_t count = ringPeek(&logRing, &run);
+		if (count > 0xFFFF) count = 0xFFFF;
+		if (count > 0 && HAL_UART_Transmit_DMA(&huart2, run, count) == HAL_OK) {
+			logInFlight = count;
+		}
+	}
+	__set_PRIMASK(primask);
+}
+
+static void logTxComplete(void) {
+	ringAdvance(&logRing, logInFlight);
+	logInFlight = 0;
+	logKick();
+}
+
+/* A failed transfer never completes - give up its bytes and carry on with
+ * the rest, or logging would stop for good */
+static void logTxError(void) {
+	logErrors++;
+	logTxComplete();
+}
+
+/* Log ring usage since boot, on the debug port */
+static void printLogStats(void) {
+	printf("Log ring high water %lu of %u bytes, %lu bytes dropped, %lu DMA errors\r\n",
+			(unsigned long)logRing.high_water, LOG_RING_SIZE, (unsigned long)logRing.overflows,
+			(unsigned long)logErrors);
+}
+
 /* Helper Functions */
 void updateLCDStatus(const char* line1, const char* line2) {
 	HD44780_Clear();
@@ -97,9 +947,28 @@ void updateLCDStatus(const char* line1, const char* line2) {
 	}
 }
 
+/* printf queues into the log ring. A full ring is waited on for up to
+ * LOG_FULL_WAIT_MS, and only in thread context with interrupts on - anywhere
+ * else the DMA cannot drain it. What still does not fit is dropped and
+ * counted in the ring's overflows. */
 int _write(int file, char *ptr, int len) {
-	// Fixed: Removed incorrect timestamp transmission
-	HAL_UART_Transmit(&huart2, (uint8_t*)ptr, len, HAL_MAX_DELAY);
+	(void)file;
+	uint32_t queued = 0;
+	uint32_t start = HAL_GetTick();
+	int can_wait = __get_PRIMASK() == 0 && __get_IPSR() == 0;
+	for (;;) {
+		uint32_t space = ringSpace(&logRing);
+		uint32_t count = ((uint32_t)len - queued < space) ? (uint32_t)len - queued : space;
+		queued += ringPush(&logRing, (uint8_t*)ptr + queued, count);
+		logKick();
+		if (queued == (uint32_t)len) {
+			break;
+		}
+		if (!can_wait || HAL_GetTick() - start >= LOG_FULL_WAIT_MS) {
+			ringPush(&logRing, (uint8_t*)ptr + queued, len - queued);  // Whatever fits, the rest counted
+			break;
+		}
+	}
 	return len;
 }
 
@@ -128,6 +997,7 @@ void printPrompt(const char* phase, const char* promptType) {
 }
 
 void updateInput(const char* promptType, int value) {
+	(void)promptType;
 	printf("\r\033[K");
 	printf("\r%d", value);
 }
@@ -156,178 +1026,940 @@ void deriveKeyFromAccessKey(void) {
 	}
 }
 
+void cipherInit(CipherStream* cipher) {
+	memcpy(cipher->keyStream, encInfo.key, KEY_SIZE);
+	cipher->position = 0;
+}
+
+/* Encrypt the next length bytes of the stream in place. Splitting a buffer
+ * across calls gives the same ciphertext as one call. */
+void cipherUpdate(CipherStream* cipher, uint8_t* data, size_t length) {
+	for(size_t n = 0; n < length; n++) {
+		size_t i = cipher->position++;
+		if(i > 0 && (i % KEY_SIZE) == 0) {
+			for(int j = 0; j < KEY_SIZE; j++) {
+				cipher->keyStream[j] = cipher->keyStream[j] ^ encInfo.key[j] ^ (i & 0xFF);
+			}
+		}
+		data[n] ^= cipher->keyStream[i % KEY_SIZE];
+	}
+}
+
 void encryptData(uint8_t* data, size_t length) {
-	uint8_t keyStream[KEY_SIZE];
-	memcpy(keyStream, encInfo.key, KEY_SIZE);
+	CipherStream cipher;
+	cipherInit(&cipher);
+	cipherUpdate(&cipher, data, length);
+}
+
+/* Encrypt message_buffer up to end, if not already done */
+static void encryptAhead(size_t end) {
+	if (end > encInfo.data_size) {
+		end = encInfo.data_size;
+	}
+	if (end > txEncrypted) {
+		cipherUpdate(&txCipher, &message_buffer[txEncrypted], end - txEncrypted);
+		txEncrypted = end;
+	}
+}
+
+/* Selection Gather */
+/* Catalog lines end in NUL, the plaintext lines in '\n' */
+static void textTerminate(uint8_t* text, size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		if (text[i] == '\0') {
+			text[i] = '\n';
+		}
+	}
+}
+
+#if ENABLE_GATHER_ENCRYPT
+static void gatherInit(TextGather* gather, const SelectionRange* range) {
+	catalogOpen(&gather->reader, catalogOffset(range->first));
+	gather->remaining = range->length;
+}
+
+/* Next length plaintext bytes - line text, its '\n', and zeros past the end */
+static void gatherRead(TextGather* gather, uint8_t* dest, size_t length) {
+	size_t count = (length < gather->remaining) ? length : gather->remaining;
+
+	catalogRead(&gather->reader, dest, count);
+	textTerminate(dest, count);
+	memset(&dest[count], 0, length - count);
+	gather->remaining -= count;
+}
+#endif
+
+/* Payload Compression */
+/* Messages are LZ77 coded against PAYLOAD_DICT, trained on content/ by
+ * tools/train_dictionary.py and built into both boards, so even a one-line
+ * message finds long matches. Sequences use the catalog's token format with
+ * a two-byte distance that reaches back through the message's own output
+ * into the end of the dictionary. Text is coded a piece at a time; a match
+ * lies within the piece or the dictionary. */
+#if ENABLE_PAYLOAD_COMPRESSION
+/* Extension bytes for a literal count or match code of 15 or more */
+static size_t compressExtend(uint8_t* out, uint32_t value) {
+	size_t n = 0;
+	if (value < 15) {
+		return 0;
+	}
+	for (value -= 15; value >= 255; value -= 255) {
+		out[n++] = 255;
+	}
+	out[n++] = (uint8_t)value;
+	return n;
+}
+
+/* Append one sequence at dest[*pos]. Returns -1 if it might not fit. */
+static int compressEmit(uint8_t* dest, size_t* pos, size_t capacity,
+		const uint8_t* literals, uint32_t count, uint32_t match, uint32_t distance) {
+	uint32_t code = match ? match - DICT_MATCH_MIN + 1 : 0;
+	if (*pos + 1 + (count / 255 + 1) + (code / 255 + 1) + 2 + count > capacity) {
+		return -1;
+	}
+
+	uint8_t* out = &dest[*pos];
+	*out++ = (uint8_t)(((count < 15) ? count : 15) << 4 | ((code < 15) ? code : 15));
+	out += compressExtend(out, count);
+	out += compressExtend(out, code);
+	if (match) {
+		*out++ = (uint8_t)(distance & 0xFF);
+		*out++ = (uint8_t)(distance >> 8);
+	}
+	memcpy(out, literals, count);
+	*pos = (out + count) - dest;
+	return 0;
+}
+
+/* Make piece position i findable by later positions */
+static void compressInsert(uint32_t i, uint32_t n) {
+	if (i + DICT_MATCH_MIN <= n) {
+		uint32_t h = PAYLOAD_DICT_HASH(&compressPiece.text[i]);
+		compressPiece.next[i] = compressPiece.head[h];
+		compressPiece.head[h] = (uint8_t)i;
+	}
+}
+
+/* Longest match for piece position i, earlier in the piece or in the
+ * dictionary, or 0 if none reaches DICT_MATCH_MIN. produced is the text
+ * coded before this piece. */
+static uint32_t compressMatch(uint32_t i, uint32_t n, uint32_t produced, uint32_t* distance) {
+	const uint8_t* text = compressPiece.text;
+	uint32_t best = 0;
+	int tries;
+
+	if (i + DICT_MATCH_MIN > n) {
+		return 0;
+	}
+	uint32_t h = PAYLOAD_DICT_HASH(&text[i]);
+
+	tries = 0;
+	for (uint8_t j = compressPiece.head[h]; j != COMPRESS_NONE && tries < DICT_CHAIN_LIMIT;
+			j = compressPiece.next[j], tries++) {
+		uint32_t length = 0;
+		while (i + length < n && text[j + length] == text[i + length]) {
+			length++;
+		}
+		if (length > best) {
+			best = length;
+			*distance = i - j;
+		}
+	}
+
+	tries = 0;
+	for (uint16_t k = PAYLOAD_DICT_HEAD[h]; k != PAYLOAD_DICT_NONE && tries < DICT_CHAIN_LIMIT;
+			k = PAYLOAD_DICT_NEXT[k], tries++) {
+		uint32_t d = produced + i + PAYLOAD_DICT_SIZE - k;
+		if (d > 0xFFFF) {
+			break;  // Chains run backwards through the dictionary, so only further from here
+		}
+		uint32_t length = 0;
+		while (i + length < n && k + length < PAYLOAD_DICT_SIZE && PAYLOAD_DICT[k + length] == text[i + length]) {
+			length++;
+		}
+		if (length > best) {
+			best = length;
+			*distance = d;
+		}
+	}
+	return (best >= DICT_MATCH_MIN) ? best : 0;
+}
+
+/* Compress the selected lines, '\n' terminated, into dest and pad with zero
+ * bytes - empty sequences - to the AES block. Returns the padded size, or -1
+ * if it does not fit in capacity. */
+static int compressSelection(const SelectionRange* range, uint8_t* dest, size_t capacity) {
+	size_t pos = 0;
+
+	catalogOpen(&textReader, catalogOffset(range->first));
+	for (uint32_t produced = 0; produced < range->length; ) {
+		uint32_t n = (range->length - produced > COMPRESS_PIECE) ? COMPRESS_PIECE : range->length - produced;
+		uint32_t literal_start = 0;
+
+		catalogRead(&textReader, compressPiece.text, n);
+		textTerminate(compressPiece.text, n);
+		memset(compressPiece.head, COMPRESS_NONE, sizeof(compressPiece.head));
+
+		for (uint32_t i = 0; i < n; ) {
+			uint32_t distance = 0;
+			uint32_t match = compressMatch(i, n, produced, &distance);
+			if (match == 0) {
+				compressInsert(i++, n);
+				continue;
+			}
+			if (compressEmit(dest, &pos, capacity, &compressPiece.text[literal_start],
+					i - literal_start, match, distance) != 0) {
+				return -1;
+			}
+			for (uint32_t end = i + match; i < end; i++) {
+				compressInsert(i, n);
+			}
+			literal_start = i;
+		}
+		if (literal_start < n && compressEmit(dest, &pos, capacity, &compressPiece.text[literal_start],
+				n - literal_start, 0, 0) != 0) {
+			return -1;
+		}
+		produced += n;
+	}
+
+	size_t padded = ((pos + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE) * AES_BLOCK_SIZE;
+	if (padded > capacity) {
+		return -1;
+	}
+	memset(&dest[pos], 0, padded - pos);
+	return (int)padded;
+}
+#endif
+
+/* Ciphertext for payload bytes [offset, offset + length), ready for the link.
+ * Chunks must be asked for in order. A gathered chunk is built in stage slot
+ * index % TX_STAGE_SLOTS and must be on its way before that slot comes round. */
+static const uint8_t* payloadChunk(size_t offset, size_t length, uint32_t index) {
+#if ENABLE_GATHER_ENCRYPT
+	if (txGatherActive) {
+		uint8_t* slot = txStage[index % TX_STAGE_SLOTS];
+		gatherRead(&txGather, slot, length);
+		cipherUpdate(&txCipher, slot, length);
+		return slot;
+	}
+#endif
+	(void)index;
+	encryptAhead(offset + length);
+	return &message_buffer[offset];
+}
+
+/* Link Transport */
+#if LINK_TRANSPORT == TRANSPORT_SPI
+static volatile uint8_t spiTxDone = 0;
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+	if (hspi == &hspi1) {
+		spiTxDone = 1;
+	}
+}
+#elif LINK_TRANSPORT == TRANSPORT_HOSTSIM
+static int hostsimFd = -1;
+#endif
+
+void Link_Init(void) {
+#if LINK_TRANSPORT == TRANSPORT_SPI
+	MX_SPI1_Init();
+#elif LINK_TRANSPORT == TRANSPORT_HOSTSIM
+	const char* path = getenv("SECUREEDU_LINK");
+	hostsimFd = path ? open(path, O_RDWR | O_NOCTTY) : -1;
+	if (hostsimFd < 0) {
+		printf("SECUREEDU_LINK not set or not openable - see tools/link_pair.c\r\n");
+		Error_Handler();
+	}
+#else
+	MX_USART1_UART_Init();
+#endif
+}
+
+/* DWT cycle counter, used for TX accounting and the link benchmark */
+static void enableCycleCounter(void) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/* DMA TX Engine */
+/* Start the chain's next non-empty segment. Runs in thread context for the
+ * first segment and from the TX-complete interrupt for the rest. */
+static void chainStartNext(TxChain* chain) {
+	while (chain->next < chain->count) {
+		const TxSegment* segment = &chain->segments[chain->next++];
+		if (segment->length == 0) {
+			continue;
+		}
+		if (HAL_UART_Transmit_DMA(chain->huart, (uint8_t*)segment->data, segment->length) != HAL_OK) {
+			chain->error = 1;
+			break;
+		}
+		return;
+	}
+	chain->busy = 0;
+}
+
+#if (LINK_TRANSPORT == TRANSPORT_UART && ENABLE_DMA_TX) || ENABLE_CHANNEL_BONDING
+/* Spin until the chain on the wire has gone out */
+static HAL_StatusTypeDef chainWait(TxChain* chain, uint32_t timeout) {
+	uint32_t start = HAL_GetTick();
+	uint32_t cycles = DWT->CYCCNT;
+	HAL_StatusTypeDef status = HAL_OK;
+
+	while (chain->busy) {
+		if (HAL_GetTick() - start > timeout) {
+			HAL_UART_AbortTransmit(chain->huart);
+			chain->busy = 0;
+			status = HAL_TIMEOUT;
+		}
+	}
+	txWait.link += DWT->CYCCNT - cycles;
+
+	if (chain->error) {
+		chain->error = 0;
+		status = HAL_ERROR;
+	}
+	return status;
+}
+
+/* Queue a chain once the previous one on this port has gone out. Only the
+ * descriptors are copied; the bytes must stay untouched until the next
+ * chainWait on this port. */
+static HAL_StatusTypeDef chainSubmit(TxChain* chain, const TxSegment* segments, uint8_t count) {
+	HAL_StatusTypeDef status = chainWait(chain, LINK_TIMEOUT);
+	if (status != HAL_OK) {
+		return status;
+	}
+
+	memcpy(chain->segments, segments, count * sizeof(TxSegment));
+	chain->count = count;
+	chain->next = 0;
+	chain->busy = 1;
+	chainStartNext(chain);
+	return HAL_OK;
+}
+#endif
+
+/* Append a segment to a frame under construction */
+static void frameAdd(TxFrame* frame, const void* data, uint16_t length) {
+	if (frame->count >= TX_MAX_SEGMENTS) {
+		Error_Handler();  // TX_MAX_SEGMENTS too small for this configuration
+	}
+	frame->segments[frame->count].data = data;
+	frame->segments[frame->count].length = length;
+	frame->count++;
+}
+
+/* Block until everything queued has left the board */
+HAL_StatusTypeDef Link_Flush(void) {
+#if ENABLE_DMA_TX && LINK_TRANSPORT == TRANSPORT_UART
+	return chainWait(&txChains[0], LINK_TIMEOUT);
+#else
+	return HAL_OK;
+#endif
+}
+
+/* Settle delay between frame sections, counted as TX wait time */
+static void txDelay(uint32_t ms) {
+	uint32_t cycles = DWT->CYCCNT;
+	HAL_Delay(ms);
+	txWait.delays += DWT->CYCCNT - cycles;
+}
+
+/* CPU time the last frame spent waiting, by cause, on the debug port */
+static void printTxUtilization(void) {
+	uint32_t window = DWT->CYCCNT - txWindowStart;
+	uint32_t stalled = txWait.link + txWait.pacing + txWait.delays + txWait.reply;
+	uint32_t cyclesPerUs = SystemCoreClock / 1000000u;
+
+	printf("TX CPU waiting %lu of %lu us (%lu%%): link %lu, pacing %lu, delays %lu, reply %lu us, %s\r\n",
+			(unsigned long)(stalled / cyclesPerUs), (unsigned long)(window / cyclesPerUs),
+			(unsigned long)(window ? (uint64_t)stalled * 100u / window : 0),
+			(unsigned long)(txWait.link / cyclesPerUs), (unsigned long)(txWait.pacing / cyclesPerUs),
+			(unsigned long)(txWait.delays / cyclesPerUs), (unsigned long)(txWait.reply / cyclesPerUs),
+			(ENABLE_DMA_TX && LINK_TRANSPORT == TRANSPORT_UART) ? "DMA" : "blocking");
+}
+
+/* Request-to-first-byte and request-to-last-byte for the last frame */
+static void printPipelineTiming(void) {
+	uint32_t cyclesPerUs = SystemCoreClock / 1000000u;
+
+	printf("Pipeline %s: %lu bytes%s, TTFB %lu us, end-to-end %lu us\r\n",
+			txGatherActive ? "gather-encrypt-while-send" :
+					ENABLE_PIPELINED_ENCRYPT ? "encrypt-while-send" : "encrypt-then-send",
+			(unsigned long)encInfo.data_size, txCompressed ? " compressed" : "",
+			(unsigned long)((txFirstByte - txRequestStart) / cyclesPerUs),
+			(unsigned long)((DWT->CYCCNT - txRequestStart) / cyclesPerUs));
+}
+
+/* Send a list of segments to the decoder straight from their buffers.
+ * Blocking transports return once the bytes have left the board; the DMA
+ * path returns once the chain is queued, and the bytes must stay untouched
+ * until Link_Flush or the next transmit. */
+HAL_StatusTypeDef Link_TransmitV(const TxSegment* segments, uint8_t count) {
+#if LINK_TRANSPORT == TRANSPORT_UART && ENABLE_DMA_TX
+	return chainSubmit(&txChains[0], segments, count);
+#else
+	uint32_t cycles = DWT->CYCCNT;
+	for (uint8_t i = 0; i < count; i++) {
+		const uint8_t* data = segments[i].data;
+		uint16_t length = segments[i].length;
+#if LINK_TRANSPORT == TRANSPORT_SPI
+		// The slave arms its DMA per field, so each segment is its own transfer
+		if (i > 0) {
+			HAL_Delay(5);
+		}
+		spiTxDone = 0;
+		HAL_StatusTypeDef status = HAL_SPI_Transmit_DMA(&hspi1, (uint8_t*)data, length);
+		if (status != HAL_OK) {
+			return status;
+		}
+
+		uint32_t start = HAL_GetTick();
+		while (!spiTxDone) {
+			if (HAL_GetTick() - start > LINK_TIMEOUT) {
+				HAL_SPI_Abort(&hspi1);
+				return HAL_TIMEOUT;
+			}
+		}
+#elif LINK_TRANSPORT == TRANSPORT_HOSTSIM
+		while (length > 0) {
+			ssize_t n = write(hostsimFd, data, length);
+			if (n <= 0) {
+				return HAL_ERROR;
+			}
+			data += n;
+			length -= n;
+		}
+#else
+		HAL_StatusTypeDef status = HAL_UART_Transmit(&huart1, (uint8_t*)data, length, HAL_MAX_DELAY);
+		if (status != HAL_OK) {
+			return status;
+		}
+#endif
+	}
+	txWait.link += DWT->CYCCNT - cycles;  // Every blocking transport holds the CPU for the whole transfer
+	return HAL_OK;
+#endif
+}
+
+/* Single-segment convenience wrapper, same lifetime rules as Link_TransmitV */
+HAL_StatusTypeDef Link_Transmit(const uint8_t* data, uint16_t length) {
+	TxSegment segment = {data, length};
+	return Link_TransmitV(&segment, 1);
+}
+
+/* Receive length bytes from the decoder's back channel or time out */
+HAL_StatusTypeDef Link_Receive(uint8_t* data, uint16_t length, uint32_t timeout) {
+#if LINK_TRANSPORT == TRANSPORT_SPI
+	// Master clocks the reply out of the slave once it has had time to load it
+	HAL_Delay(5);
+	return HAL_SPI_Receive(&hspi1, data, length, timeout);
+#elif LINK_TRANSPORT == TRANSPORT_HOSTSIM
+	uint32_t start = HAL_GetTick();
+	while (length > 0) {
+		uint32_t elapsed = HAL_GetTick() - start;
+		struct pollfd pfd = { .fd = hostsimFd, .events = POLLIN };
+		if (elapsed >= timeout || poll(&pfd, 1, timeout - elapsed) <= 0) {
+			return HAL_TIMEOUT;
+		}
+		ssize_t n = read(hostsimFd, data, length);
+		if (n <= 0) {
+			return HAL_ERROR;
+		}
+		data += n;
+		length -= n;
+	}
+	return HAL_OK;
+#else
+	return HAL_UART_Receive(&huart1, data, length, timeout);
+#endif
+}
+
+/* Pacing Controller */
+#if !ENABLE_BROADCAST_MODE && !ENABLE_CHANNEL_BONDING
+/* Additive increase / multiplicative decrease: every clean frame grows the
+ * chunk and shrinks the gap by a step, every error or timeout halves the
+ * chunk and doubles the gap. */
+static void pacingUpdate(LinkResult result) {
+	PacingSample* sample = &pacing.history[pacing.history_head];
+	sample->chunk_size = pacing.chunk_size;
+	sample->gap_ms = pacing.gap_ms;
+	sample->result = result;
+	pacing.history_head = (pacing.history_head + 1) % PACING_HISTORY;
+	pacing.frames++;
+
+	if (result == LINK_RESULT_OK) {
+		pacing.chunk_size += PACING_CHUNK_STEP;
+		if (pacing.chunk_size > PACING_MAX_CHUNK) {
+			pacing.chunk_size = PACING_MAX_CHUNK;
+		}
+		pacing.gap_ms = (pacing.gap_ms > PACING_GAP_STEP) ? pacing.gap_ms - PACING_GAP_STEP : 0;
+		return;
+	}
+
+	if (result == LINK_RESULT_TIMEOUT) {
+		pacing.timeouts++;
+	} else {
+		pacing.errors++;
+	}
+	pacing.chunk_size /= 2;
+	if (pacing.chunk_size < PACING_MIN_CHUNK) {
+		pacing.chunk_size = PACING_MIN_CHUNK;
+	}
+	pacing.gap_ms = pacing.gap_ms * 2 + 1;
+	if (pacing.gap_ms > PACING_MAX_GAP) {
+		pacing.gap_ms = PACING_MAX_GAP;
+	}
+}
+#endif
+
+/* Current settings, session rates and recent history on the debug port */
+void printPacing(void) {
+	static const char* const names[] = {"ok", "error", "timeout"};
+
+	printf("\r\n=== Link Pacing =================================\r\n");
+	printf("Chunk: %u bytes, Gap: %u ms\r\n", pacing.chunk_size, pacing.gap_ms);
+	printf("Frames: %lu, Errors: %lu, Timeouts: %lu\r\n",
+			(unsigned long)pacing.frames, (unsigned long)pacing.errors, (unsigned long)pacing.timeouts);
+
+	uint32_t count = (pacing.frames < PACING_HISTORY) ? pacing.frames : PACING_HISTORY;
+	for (uint32_t i = 0; i < count; i++) {
+		uint8_t index = (pacing.history_head + PACING_HISTORY - count + i) % PACING_HISTORY;
+		PacingSample* sample = &pacing.history[index];
+		printf("  #%lu chunk=%u gap=%u %s\r\n", (unsigned long)(pacing.frames - count + i),
+				sample->chunk_size, sample->gap_ms, names[sample->result]);
+	}
+	printf("===============================================\r\n");
+}
+
+#if !ENABLE_BROADCAST_MODE && !ENABLE_CHANNEL_BONDING
+/* Wait for the decoder's status byte and feed the outcome to the controller */
+static void awaitLinkStatus(int tx_failed) {
+	uint8_t reply = 0;
+
+	if (Link_Receive(&reply, 1, LINK_STATUS_TIMEOUT) != HAL_OK) {
+		printf("No link status from decoder\r\n");
+		pacingUpdate(LINK_RESULT_TIMEOUT);
+	} else if (tx_failed || reply != LINK_ACK) {
+		printf("Decoder reported error (0x%02X)\r\n", reply);
+		pacingUpdate(LINK_RESULT_ERROR);
+	} else {
+		pacingUpdate(LINK_RESULT_OK);
+	}
+	printPacing();
+}
+#endif
+
+/* Per-frame envelope pad: the frame timestamp enciphered under the device key
+ * with Speck64/128 (64-bit block, 128-bit key, 27 rounds). An addressed
+ * decoder learns the access key and so every other envelope's pad, but a pad
+ * is a cipher output, so it gives away neither the device key behind it nor
+ * the pad for any other timestamp. Pads repeat only if a timestamp does - it
+ * is HAL_GetTick, so across power cycles. Keep in step with envelopePad in FINAL_DECODER.c. */
+static uint32_t padRor(uint32_t x, int r) { return (x >> r) | (x << (32 - r)); }
+static uint32_t padRol(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+
+static void envelopePad(const uint8_t* device_key, uint32_t timestamp, uint8_t* pad) {
+	uint32_t l[3];
+	uint32_t k;
+	uint32_t x = timestamp;
+	uint32_t y = 0x57524150;  // "WRAP", keeps the block apart from other uses of the key
+
+	memcpy(&k, device_key, 4);  // Little-endian words, k first
+	memcpy(l, device_key + 4, 12);
+	for(uint32_t i = 0; i < 27; i++) {
+		x = (padRor(x, 8) + y) ^ k;
+		y = padRol(y, 3) ^ x;
+		uint32_t next = (k + padRor(l[i % 3], 8)) ^ i;
+		k = padRol(k, 3) ^ next;
+		l[i % 3] = next;
+	}
+	memcpy(pad, &x, 4);
+	memcpy(pad + 4, &y, 4);
+}
+
+/* Wrap the access key for one recipient under this frame's pad */
+static void wrapAccessKey(const uint8_t* device_key, uint32_t timestamp,
+		const uint8_t* in, uint8_t* out) {
+	uint8_t pad[ACCESS_KEY_SIZE];
+	envelopePad(device_key, timestamp, pad);
+	for(int i = 0; i < ACCESS_KEY_SIZE; i++) {
+		out[i] = in[i] ^ pad[i];
+	}
+}
+
+/* Recipient count followed by one envelope per addressed decoder */
+static void addEnvelopes(TxFrame* frame) {
+    txEnvelopeCount = NUM_RECIPIENTS;
+    printf("Sending %u key envelopes...\r\n", txEnvelopeCount);
+    frameAdd(frame, &txEnvelopeCount, 1);
+
+    for(int i = 0; i < txEnvelopeCount; i++) {
+        txEnvelopes[i][0] = RECIPIENTS[i].address;
+        wrapAccessKey(RECIPIENTS[i].device_key, encInfo.timestamp, encInfo.access_key, &txEnvelopes[i][1]);
+        frameAdd(frame, txEnvelopes[i], ENVELOPE_SIZE);
+        printf("Envelope for decoder 0x%02X\r\n", txEnvelopes[i][0]);
+    }
+}
+
+/* Start marker, key field and timestamp - shared by single and batch frames.
+ * Point-to-point frames carry the access key, broadcast frames carry envelopes.
+ * Every field is its own segment since the decoder reads them one by one.
+ * The Cortex-M4 is little-endian, so 32-bit fields go out straight from memory. */
+static void addHeader(TxFrame* frame, uint8_t marker) {
+    printf("\r\nStarting transmission...\r\n");
+    memset(&txWait, 0, sizeof(txWait));
+    txWindowStart = DWT->CYCCNT;
+
+    printf("Sending start marker (0x%02X)...\r\n", marker);
+    txMarker = marker;
+    frameAdd(frame, &txMarker, 1);
+
+    uint8_t kind = marker & ~COMPRESSED_MARKER_FLAG;
+    if (kind == BROADCAST_START_MARKER || kind == BROADCAST_BATCH_START_MARKER) {
+        addEnvelopes(frame);
+    } else {
+        printf("Sending access key: %.*s\r\n", ACCESS_KEY_SIZE, (const char*)encInfo.access_key);
+        frameAdd(frame, encInfo.access_key, ACCESS_KEY_SIZE);
+    }
+
+    printf("Sending timestamp: %lu\r\n", (unsigned long)encInfo.timestamp);
+    frameAdd(frame, &encInfo.timestamp, sizeof(encInfo.timestamp));
+}
+
+/* Codec field of a compressed frame, after the size or directory */
+static void addCodec(TxFrame* frame) {
+    if (txCompressed) {
+        printf("Sending codec: dictionary %08lX, %lu text bytes\r\n",
+                (unsigned long)txCodec.dictionary, (unsigned long)txCodec.text_size);
+        frameAdd(frame, &txCodec, sizeof(txCodec));
+    }
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+	if (huart == &huart2) {
+		logTxError();
+	}
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+	if (huart == &huart2) {
+		logTxComplete();
+	}
+
+	for (int i = 0; i < BOND_PORTS; i++) {
+		if (txChains[i].huart == huart && txChains[i].busy) {
+			chainStartNext(&txChains[i]);
+		}
+	}
+}
+
+#if ENABLE_CHANNEL_BONDING
+/* Wait until a bonded port has finished its last chunk. Returns 0 on success. */
+static int waitBondPort(int port) {
+	if (chainWait(&txChains[port], BOND_TX_TIMEOUT) != HAL_OK) {
+		printf("Bonded port %d stalled\r\n", port);
+		return -1;
+	}
+	return 0;
+}
+
+/* Stripe the payload round-robin over the bonded ports. Each chunk carries its
+ * sequence number so the decoder can reassemble regardless of port skew.
+ * A port only waits for its own previous chunk, so all ports run in parallel.
+ * The chunk goes out of its ciphertext buffer directly, chained behind its header. */
+static int transmitBonded(void) {
+    size_t sent = 0;
+    uint16_t seq = 0;
+
+    printf("Sending encrypted data over %d bonded ports...\r\n", BOND_PORTS);
+    while (sent < encInfo.data_size) {
+        int port = seq % BOND_PORTS;
+        size_t chunk = (encInfo.data_size - sent > BOND_CHUNK_SIZE) ? BOND_CHUNK_SIZE : encInfo.data_size - sent;
+        uint8_t* header = bondTxHeader[port];
+
+        // Encrypted while the other ports are still sending
+        const uint8_t* data = payloadChunk(sent, chunk, seq);
+
+        // Also keeps the header below untouched until the port's last chunk is out
+        if (waitBondPort(port) != 0) {
+            return -1;
+        }
+
+        bondPackHeader(header, seq, (uint8_t)chunk);
+
+        TxSegment segments[2] = {{header, BOND_HEADER_SIZE}, {data, chunk}};
+        if (chainSubmit(&txChains[port], segments, 2) != HAL_OK) {
+            printf("Error starting DMA on bonded port %d at chunk %u\r\n", port, seq);
+            return -1;
+        }
+
+        sent += chunk;
+        seq++;
+    }
 
-	for(size_t i = 0; i < length; i++) {
-		if(i > 0 && (i % KEY_SIZE) == 0) {
-			for(int j = 0; j < KEY_SIZE; j++) {
-				keyStream[j] = keyStream[j] ^ encInfo.key[j] ^ (i & 0xFF);
-			}
-		}
-		data[i] ^= keyStream[i % KEY_SIZE];
-	}
+    for (int i = 0; i < BOND_PORTS; i++) {
+        if (waitBondPort(i) != 0) {
+            return -1;
+        }
+    }
+    printf("Sent %u chunks, %lu bytes\r\n", seq, (unsigned long)encInfo.data_size);
+    return 0;
 }
+#endif
+
+/* Encrypted payload in chunks followed by the end marker */
+static void transmitPayload(void) {
+    int tx_failed = 0;
+#if ENABLE_CHANNEL_BONDING
+    if (transmitBonded() != 0) {
+        updateLCDStatus("Error:", "Bonded TX fail");
+        return;
+    }
+#else
+    printf("Sending encrypted data (chunk %u, gap %u ms)...\r\n", pacing.chunk_size, pacing.gap_ms);
+    size_t sent = 0;
+    uint32_t index = 0;
+    size_t chunk = (encInfo.data_size > pacing.chunk_size) ? pacing.chunk_size : encInfo.data_size;
+    const uint8_t* data = payloadChunk(0, chunk, index);
+    while (sent < encInfo.data_size) {
+        if (Link_Transmit(data, chunk) != HAL_OK) {
+            printf("Error transmitting chunk at byte %zu\r\n", sent);
+            tx_failed = 1;
+            break;
+        }
+        uint32_t queued = HAL_GetTick();
+        sent += chunk;
+        index++;
 
-void transmitWithBuffer(const uint8_t* data, size_t length) {
-	size_t bytes_sent = 0;
-	while (bytes_sent < length) {
-		size_t chunk_size = ((length - bytes_sent) > 16) ? 16 : (length - bytes_sent);
+        // Next chunk is encrypted while this one is on the wire
+        chunk = (encInfo.data_size - sent > pacing.chunk_size) ? pacing.chunk_size : encInfo.data_size - sent;
+        if (chunk > 0) {
+            data = payloadChunk(sent, chunk, index);
+        }
 
-		memcpy(tx_buffer, &data[bytes_sent], chunk_size);
-		HAL_StatusTypeDef status = HAL_UART_Transmit(&huart1, tx_buffer, chunk_size, HAL_MAX_DELAY);
+        if (sent % 128 == 0 || sent == encInfo.data_size) {
+            printf("Sent %zu of %lu bytes\r\n", sent, (unsigned long)encInfo.data_size);
+        }
+        uint32_t cycles = DWT->CYCCNT;
+        while (HAL_GetTick() - queued < pacing.gap_ms) {
+        }
+        txWait.pacing += DWT->CYCCNT - cycles;
+    }
+#endif
+    txDelay(50);
 
-		if (status != HAL_OK) {
-			printf("Error transmitting chunk at byte %zu\r\n", bytes_sent);
-			return;
-		}
+    // Send end marker
+    printf("Sending end marker (0x%02X)...\r\n", txEndMarker);
+    Link_Transmit(&txEndMarker, 1);
+    if (Link_Flush() != HAL_OK) {
+        tx_failed = 1;
+    }
+    printPipelineTiming();
+    printLogStats();
+
+#if !ENABLE_BROADCAST_MODE && !ENABLE_CHANNEL_BONDING
+    // Broadcast frames get no reply - several decoders would collide on the bus
+    uint32_t cycles = DWT->CYCCNT;
+    awaitLinkStatus(tx_failed);
+    txWait.reply += DWT->CYCCNT - cycles;
+#else
+    (void)tx_failed;
+#endif
+    txDelay(50);
+    printTxUtilization();
 
-		bytes_sent += chunk_size;
-		HAL_Delay(10);  // Increased delay between chunks
-	}
+    printf("\r\nTransmission complete!\r\n");
 }
 
 // Fixed: Updated transmitEncryptedData function
 void transmitEncryptedData(void) {
-    printf("\r\nStarting transmission...\r\n");
+    TxFrame frame = {0};
 
-    // Send start marker
-    uint8_t startMarker = 0xAA;
-    printf("Sending start marker (0xAA)...\r\n");
-    HAL_UART_Transmit(&huart1, &startMarker, 1, HAL_MAX_DELAY);
-    HAL_Delay(50);
+    addHeader(&frame, (ENABLE_BROADCAST_MODE ? BROADCAST_START_MARKER : START_MARKER) |
+            (txCompressed ? COMPRESSED_MARKER_FLAG : 0));
+    printf("Sending data size: %lu bytes\r\n", (unsigned long)encInfo.data_size);
+    frameAdd(&frame, &encInfo.data_size, sizeof(encInfo.data_size));
+    addCodec(&frame);
+    txFirstByte = DWT->CYCCNT;
+    Link_TransmitV(frame.segments, frame.count);
+    txDelay(50);
 
-    // Print access key for debugging
-    printf("Access key before sending: ");
-    for(int i = 0; i < ACCESS_KEY_SIZE; i++) {
-        printf("%c", encInfo.access_key[i]);
-    }
-    printf("\r\n");
+    transmitPayload();
+}
 
-    // Send access key with explicit length checking
-    printf("Sending access key...\r\n");
-    for(int i = 0; i < ACCESS_KEY_SIZE; i++) {
-        HAL_UART_Transmit(&huart1, &encInfo.access_key[i], 1, HAL_MAX_DELAY);
-        printf("Sent byte %d: '%c' (0x%02X)\r\n", i, encInfo.access_key[i], encInfo.access_key[i]);
-        HAL_Delay(5);
+/* Batch frame: one header, a directory of message sizes, then all payloads back to back */
+void transmitBatch(void) {
+    TxFrame frame = {0};
+
+    addHeader(&frame, (ENABLE_BROADCAST_MODE ? BROADCAST_BATCH_START_MARKER : BATCH_START_MARKER) |
+            (txCompressed ? COMPRESSED_MARKER_FLAG : 0));
+    printf("Sending batch directory: %u messages\r\n", batchCount);
+    frameAdd(&frame, &batchCount, 1);
+    for(int i = 0; i < batchCount; i++) {
+        printf("Message %d: %lu bytes\r\n", i, (unsigned long)batchSizes[i]);
+        frameAdd(&frame, &batchSizes[i], sizeof(batchSizes[i]));
     }
-    HAL_Delay(50);
+    addCodec(&frame);
+    txFirstByte = DWT->CYCCNT;
+    Link_TransmitV(frame.segments, frame.count);
+    txDelay(50);
 
-    // Send timestamp as 4 separate bytes
-    printf("Sending timestamp: %lu\r\n", (unsigned long)encInfo.timestamp);
-    uint32_t timestamp = encInfo.timestamp;
-    uint8_t timestamp_bytes[4] = {
-        (uint8_t)(timestamp & 0xFF),
-        (uint8_t)((timestamp >> 8) & 0xFF),
-        (uint8_t)((timestamp >> 16) & 0xFF),
-        (uint8_t)((timestamp >> 24) & 0xFF)
-    };
-
-    for(int i = 0; i < 4; i++) {
-        HAL_UART_Transmit(&huart1, &timestamp_bytes[i], 1, HAL_MAX_DELAY);
-        printf("Sent timestamp byte %d: 0x%02X\r\n", i, timestamp_bytes[i]);
-        HAL_Delay(5);
+    transmitPayload();
+}
+
+/* Copy the selected lines into dest, '\n' terminated and zero padded.
+ * Returns -1, before anything is copied, if the padded text does not fit. */
+static int copySelection(const SelectionRange* range, uint8_t* dest, size_t capacity) {
+    if (range->padded > capacity) {
+        return -1;
     }
-    HAL_Delay(50);
 
-    // Send data size as 4 separate bytes
-    uint32_t size = encInfo.data_size;
-    uint8_t size_bytes[4] = {
-        (uint8_t)(size & 0xFF),
-        (uint8_t)((size >> 8) & 0xFF),
-        (uint8_t)((size >> 16) & 0xFF),
-        (uint8_t)((size >> 24) & 0xFF)
-    };
+    catalogOpen(&textReader, catalogOffset(range->first));
+    catalogRead(&textReader, dest, range->length);
+    textTerminate(dest, range->length);
+    memset(&dest[range->length], 0, range->padded - range->length);
+    return 0;
+}
 
-    printf("Sending data size: %lu bytes\r\n", (unsigned long)encInfo.data_size);
-    for(int i = 0; i < 4; i++) {
-        HAL_UART_Transmit(&huart1, &size_bytes[i], 1, HAL_MAX_DELAY);
-        printf("Sent size byte %d: 0x%02X\r\n", i, size_bytes[i]);
-        HAL_Delay(5);
+/* Compress count selections back to back into message_buffer, each padded on
+ * its own, with their sizes in sizes[]. Sets txCompressed and returns the
+ * payload size, or returns 0 - the frame then goes out uncompressed - if the
+ * text is more than the decoder holds, or the result does not fit or would
+ * not be smaller than the padded text. */
+static size_t compressRanges(const SelectionRange* ranges, uint32_t* sizes, int count) {
+    txCompressed = 0;
+#if ENABLE_PAYLOAD_COMPRESSION
+    size_t text_size = 0;
+    size_t padded_size = 0;
+    size_t offset = 0;
+    uint32_t start = DWT->CYCCNT;
+
+    for (int i = 0; i < count; i++) {
+        text_size += ranges[i].length;
+        padded_size += ranges[i].padded;
+    }
+    if (text_size > MAX_TEXT_SIZE) {
+        return 0;
     }
-    HAL_Delay(50);
-
-    // Send encrypted data in chunks
-    printf("Sending encrypted data...\r\n");
-    size_t sent = 0;
-    while (sent < encInfo.data_size) {
-        size_t chunk = (encInfo.data_size - sent > 16) ? 16 : encInfo.data_size - sent;
-        memcpy(tx_buffer, &encrypted_buffer[sent], chunk);
-        HAL_UART_Transmit(&huart1, tx_buffer, chunk, HAL_MAX_DELAY);
-        sent += chunk;
 
-        if (sent % 128 == 0 || sent == encInfo.data_size) {
-            printf("Sent %zu of %lu bytes\r\n", sent, (unsigned long)encInfo.data_size);
+    for (int i = 0; i < count; i++) {
+        int size = compressSelection(&ranges[i], &message_buffer[offset], MAX_TEXT_SIZE - offset);
+        if (size < 0) {
+            return 0;
         }
-        HAL_Delay(10);
+        sizes[i] = size;
+        offset += size;
+    }
+    uint32_t us = (DWT->CYCCNT - start) / (SystemCoreClock / 1000000u);
+
+    // The codec field goes on the wire too
+    size_t wire = offset + sizeof(txCodec);
+    printf("Compressed %lu -> %lu bytes on the wire (%lu%%) in %lu us\r\n",
+            (unsigned long)padded_size, (unsigned long)wire,
+            (unsigned long)(wire * 100u / padded_size), (unsigned long)us);
+    if (wire >= padded_size) {
+        printf("No gain, sending uncompressed\r\n");
+        return 0;
     }
-    HAL_Delay(50);
+#if LINK_TRANSPORT == TRANSPORT_UART
+    // 10 bits a byte with start and stop bits; pacing gaps come on top
+    uint32_t baud = huart1.Init.BaudRate;
+    printf("Saves %lu bytes, %lu us of wire time at %lu baud\r\n", (unsigned long)(padded_size - wire),
+            (unsigned long)((uint64_t)(padded_size - wire) * 10u * 1000000u / baud), (unsigned long)baud);
+#endif
+
+    txCodec.text_size = text_size;
+    txCompressed = 1;
+    return offset;
+#else
+    (void)ranges;
+    (void)sizes;
+    (void)count;
+    return 0;
+#endif
+}
 
-    // Send end marker
-    uint8_t endMarker = 0x55;
-    printf("Sending end marker (0x55)...\r\n");
-    HAL_UART_Transmit(&huart1, &endMarker, 1, HAL_MAX_DELAY);
-    HAL_Delay(50);
+/* Generate a fresh access key for encInfo.data_size bytes of payload.
+ * With the pipeline the payload is encrypted chunk by chunk as it is sent,
+ * otherwise all of it is encrypted here before the first byte goes out.
+ * A gathered payload has no buffer to encrypt ahead, so it always streams. */
+static void encryptBuffer(void) {
+    updateLCDStatus("Generating", "Access Key...");
+    generateAccessKey();
+    encInfo.timestamp = HAL_GetTick();
+    deriveKeyFromAccessKey();
 
-    printf("\r\nTransmission complete!\r\n");
+    cipherInit(&txCipher);
+    txEncrypted = 0;
+    updateLCDStatus("Encrypting...", "Please Wait");
+#if !ENABLE_PIPELINED_ENCRYPT
+    if (!txGatherActive) {
+        encryptAhead(encInfo.data_size);
+    }
+#endif
 }
 
 void encryptSelectedText(void) {
-    size_t total_len = 0;  // Declare this at the beginning
-    size_t padded_size;    // Declare this at the beginning
-
-    // Copy selected text to buffer
-    for (int p = startPos.paragraph; p <= endPos.paragraph; p++) {
-        for (int l = 0; PARAGRAPHS[p][l] != NULL; l++) {
-            if ((p == startPos.paragraph && l >= startPos.line) ||
-                    (p == endPos.paragraph && l <= endPos.line) ||
-                    (p > startPos.paragraph && p < endPos.paragraph)) {
-
-                size_t line_len = strlen(PARAGRAPHS[p][l]);
-                if (total_len + line_len + 1 > MAX_TEXT_SIZE) {
-                    printf("\r\nError: Selected text too large\r\n");
-                    updateLCDStatus("Error:", "Text too large!");
-                    return;
-                }
-
-                memcpy(&text_buffer[total_len], PARAGRAPHS[p][l], line_len);
-                total_len += line_len;
-                text_buffer[total_len++] = '\n';
-            }
-        }
+    SelectionRange range;
+
+    txRequestStart = DWT->CYCCNT;
+
+    if (rangeResolve(&startPos, &endPos, &range) != 0) {
+        return;
     }
+    size_t total_len = range.length;
+    size_t padded_size = range.padded;
 
-    // Calculate padded size
-    padded_size = ((total_len + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE) * AES_BLOCK_SIZE;
+    // A compressed selection is small enough to go out of message_buffer
+    uint32_t compressed_size;
+    if (compressRanges(&range, &compressed_size, 1) > 0) {
+        padded_size = compressed_size;
+    }
+#if !ENABLE_GATHER_ENCRYPT
+    // Copy selected text to buffer, padded
+    else if (copySelection(&range, message_buffer, MAX_TEXT_SIZE) != 0) {
+        printf("\r\nError: Selected text too large\r\n");
+        updateLCDStatus("Error:", "Text too large!");
+        return;
+    }
+#endif
+    // With the gather the lines stay in the catalog - the range already sized the
+    // header and rangeResolve capped it at what the decoder takes
 
     // Now add the debug prints after we have the values
     printf("\r\nPreparing text for encryption:\r\n");
     printf("Total text length: %zu\r\n", total_len);
     printf("Padded size: %zu\r\n", padded_size);
-    printf("First 32 bytes of text: ");
-    for(int i = 0; i < 32 && i < total_len; i++) {
-        printf("%02X ", text_buffer[i]);
+    printf("First 32 bytes of %s: ", txCompressed ? "payload" : "text");
+    const uint8_t* preview = message_buffer;
+#if ENABLE_GATHER_ENCRYPT
+    uint8_t gathered[32];
+    if (!txCompressed) {
+        gatherInit(&txGather, &range);
+        gatherRead(&txGather, gathered, sizeof(gathered));
+        gatherInit(&txGather, &range);  // Rewound for the payload
+        txGatherActive = 1;
+        preview = gathered;
+    }
+#endif
+    for(size_t i = 0; i < 32 && i < (txCompressed ? padded_size : total_len); i++) {
+        printf("%02X ", preview[i]);
     }
     printf("\r\n");
 
-    // Copy to encrypted buffer and pad
-    memcpy(encrypted_buffer, text_buffer, total_len);
-    memset(&encrypted_buffer[total_len], 0, padded_size - total_len);
-
     encInfo.data_size = padded_size;
 
     // Generate access key and encrypt
-    updateLCDStatus("Generating", "Access Key...");
-    generateAccessKey();
-    encInfo.timestamp = HAL_GetTick();
-    deriveKeyFromAccessKey();
-
-    updateLCDStatus("Encrypting...", "Please Wait");
-    encryptData(encrypted_buffer, padded_size);
+    encryptBuffer();
 
     // Transmit encrypted data
     transmitEncryptedData();
+    txGatherActive = 0;
 
     char keyBuffer[16];
     snprintf(keyBuffer, 16, "Key: %s", encInfo.access_key);
@@ -340,6 +1972,91 @@ void encryptSelectedText(void) {
     printf("===============================================\r\n\n");
 }
 
+/* Add the current selection to the batch queue. Returns 1 once the queue is full.
+ * A selection that would take the batch past MAX_BATCH_BYTES is turned away on
+ * its own; what is already queued stays queued. */
+int queueSelection(const SelectionRange* range) {
+    if (batchBytes + range->padded > MAX_BATCH_BYTES) {
+        printf("Selection not queued: %lu bytes, %lu of %lu left in the batch\r\n",
+                (unsigned long)range->padded, (unsigned long)(MAX_BATCH_BYTES - batchBytes),
+                (unsigned long)MAX_BATCH_BYTES);
+        updateLCDStatus("Not queued:", "Batch too large!");
+        return 0;
+    }
+
+    batchQueue[batchCount].start = startPos;
+    batchQueue[batchCount].end = endPos;
+    batchCount++;
+    batchBytes += range->padded;
+
+    printf("Queued selection %u of %d\r\n", batchCount, MAX_BATCH_SELECTIONS);
+    printf("Press ENTER at the paragraph prompt to send the batch\r\n");
+
+    char lcdBuffer[16];
+    snprintf(lcdBuffer, 16, "Queued %u/%d", batchCount, MAX_BATCH_SELECTIONS);
+    updateLCDStatus(lcdBuffer, "ENTER to send");
+
+    return batchCount >= MAX_BATCH_SELECTIONS;
+}
+
+/* Encrypt every queued selection under one key and send them as a single frame train */
+void encryptBatch(void) {
+    SelectionRange ranges[MAX_BATCH_SELECTIONS];
+    size_t offset = 0;
+
+    if (batchCount == 0) {
+        return;
+    }
+    txRequestStart = DWT->CYCCNT;
+
+    // Each message is padded on its own so the decoder can split on the directory.
+    // Everything is sized first, so an oversize batch is turned away before any copying.
+    for (int i = 0; i < batchCount; i++) {
+        if (rangeResolve(&batchQueue[i].start, &batchQueue[i].end, &ranges[i]) != 0 ||
+                offset + ranges[i].padded > MAX_BATCH_BYTES) {
+            printf("\r\nError: Batch too large at selection %d\r\n", i);
+            updateLCDStatus("Error:", "Batch too large!");
+            batchCount = 0;
+            batchBytes = 0;
+            return;
+        }
+        batchSizes[i] = ranges[i].padded;
+        offset += ranges[i].padded;
+    }
+
+    size_t compressed = compressRanges(ranges, batchSizes, batchCount);
+    if (compressed > 0) {
+        offset = compressed;
+    } else {
+        offset = 0;
+        for (int i = 0; i < batchCount; i++) {
+            batchSizes[i] = ranges[i].padded;
+            copySelection(&ranges[i], &message_buffer[offset], MAX_TEXT_SIZE - offset);
+            offset += ranges[i].padded;
+        }
+    }
+
+    encInfo.data_size = offset;
+    printf("\r\nBatch of %u selections, %lu bytes total\r\n",
+            batchCount, (unsigned long)encInfo.data_size);
+
+    encryptBuffer();
+    transmitBatch();
+
+    char keyBuffer[16];
+    snprintf(keyBuffer, 16, "Key: %s", encInfo.access_key);
+    updateLCDStatus("Batch Sent!", keyBuffer);
+
+    printf("\r\n=== Batch Encryption Complete ===================\r\n");
+    printf("Access Key: %s\r\n", encInfo.access_key);
+    printf("Messages: %u, Data Size: %lu bytes\r\n", batchCount, (unsigned long)encInfo.data_size);
+    printf("Store this access key to decrypt the text!\r\n");
+    printf("===============================================\r\n\n");
+
+    batchCount = 0;
+    batchBytes = 0;
+}
+
 void printSelectedText(void) {
 	clearScreen();
 	printLegend();
@@ -352,25 +2069,151 @@ void printSelectedText(void) {
 	snprintf(lcdBuffer, 16, "From P%d,L%d", startPos.paragraph, startPos.line);
 	updateLCDStatus(lcdBuffer, "Processing...");
 
-	if (endPos.paragraph < startPos.paragraph ||
-			(endPos.paragraph == startPos.paragraph && endPos.line < startPos.line)) {
+	SelectionRange range;
+	int resolved = rangeResolve(&startPos, &endPos, &range);
+	if (resolved == RANGE_INVALID) {
 		printf("Invalid selection! End must be after start.\r\n");
 		updateLCDStatus("Error:", "Invalid Range!");
 		return;
 	}
+	if (resolved == RANGE_TOO_LARGE) {
+		printf("\r\nError: Selected text too large (%lu bytes padded, the decoder takes %d)\r\n",
+				(unsigned long)range.padded, DECODER_MAX_DATA_SIZE);
+		updateLCDStatus("Error:", "Text too large!");
+		return;
+	}
 
-	for (int p = startPos.paragraph; p <= endPos.paragraph; p++) {
-		for (int l = 0; PARAGRAPHS[p][l] != NULL; l++) {
-			if ((p == startPos.paragraph && l >= startPos.line) ||
-					(p == endPos.paragraph && l <= endPos.line) ||
-					(p > startPos.paragraph && p < endPos.paragraph)) {
-				printf("%-75s\r\n", PARAGRAPHS[p][l]);
-			}
+	catalogOpen(&textReader, catalogOffset(range.first));
+	for (uint32_t n = range.first; n <= range.last; n++) {
+		char text[64];
+		size_t length = catalogLength(n);
+		for (size_t left = length; left > 0; ) {
+			size_t count = (left < sizeof(text)) ? left : sizeof(text);
+			catalogRead(&textReader, (uint8_t*)text, count);
+			printf("%.*s", (int)count, text);
+			left -= count;
 		}
+		catalogRead(&textReader, NULL, 1);  // Terminator
+		printf("%*s\r\n", (int)(length < 75 ? 75 - length : 0), "");
 	}
-	printf("\r\n");
+	printf("%lu lines, %lu bytes (%lu padded)\r\n\r\n", (unsigned long)(range.last - range.first + 1),
+			(unsigned long)range.length, (unsigned long)range.padded);
 
+#if ENABLE_BATCH_MODE
+	if (queueSelection(&range)) {
+		encryptBatch();
+	}
+#else
 	encryptSelectedText();
+#endif
+	storeReport();  // Listing and encryption together
+}
+
+/* Link Benchmark */
+/* TX->RX loopback on huart1 (jumper PA9 to PA10) across baud rates, chunk
+ * sizes and gaps. Reports goodput, corrupt and timed-out chunks and per-chunk latency
+ * percentiles on the debug UART. tools/link_bench.c runs the same sweep on a
+ * pty pair so host and target numbers line up. */
+static const uint32_t BENCH_BAUDS[] = {115200, 230400, 460800, 921600};
+static const uint16_t BENCH_CHUNKS[] = {16, 32, 64, 128, 256};
+static const uint16_t BENCH_GAPS[] = {0, 2, 10};
+
+static uint8_t benchTx[256];
+static uint8_t benchRx[256];
+static uint32_t benchLatency[BENCH_MAX_CHUNKS];
+static volatile uint8_t benchRxDone = 0;
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+	if (huart == &huart1) {
+		benchRxDone = 1;
+	}
+}
+
+/* Microseconds since a CYCCNT reading - subtracting before dividing keeps
+ * intervals right across the counter wrap */
+static uint32_t benchMicrosSince(uint32_t start) {
+	return (DWT->CYCCNT - start) / (SystemCoreClock / 1000000u);
+}
+
+static void benchSort(uint32_t* values, uint32_t count) {
+	for (uint32_t i = 1; i < count; i++) {
+		uint32_t v = values[i];
+		uint32_t j = i;
+		while (j > 0 && values[j - 1] > v) {
+			values[j] = values[j - 1];
+			j--;
+		}
+		values[j] = v;
+	}
+}
+
+static void benchRun(uint32_t baud, uint16_t chunk, uint16_t gap) {
+	uint32_t chunks = BENCH_BYTES_PER_RUN / chunk;
+	uint32_t corrupt = 0;
+	uint32_t timeouts = 0;
+	uint32_t goodBytes = 0;
+	// Expected wire time for 8N1 plus slack before a chunk counts as lost
+	uint32_t timeoutUs = chunk * 10u * 1000000u / baud + BENCH_RX_SLACK_US;
+
+	uint32_t start = DWT->CYCCNT;
+	for (uint32_t c = 0; c < chunks; c++) {
+		for (uint16_t i = 0; i < chunk; i++) {
+			benchTx[i] = (uint8_t)(c * 31u + i * 7u + 0x5A);
+		}
+		memset(benchRx, 0, chunk);
+
+		benchRxDone = 0;
+		uint32_t t0 = DWT->CYCCNT;
+		HAL_UART_Receive_IT(&huart1, benchRx, chunk);
+		HAL_UART_Transmit(&huart1, benchTx, chunk, HAL_MAX_DELAY);
+		while (!benchRxDone && benchMicrosSince(t0) < timeoutUs) {
+		}
+		benchLatency[c] = benchMicrosSince(t0);
+
+		// A chunk that never completed is lost; one that completed wrong is corrupt
+		if (!benchRxDone) {
+			timeouts++;
+			HAL_UART_AbortReceive(&huart1);
+		} else if (memcmp(benchTx, benchRx, chunk) != 0) {
+			corrupt++;
+		} else {
+			goodBytes += chunk;
+		}
+		HAL_Delay(gap);
+	}
+	uint32_t elapsed = benchMicrosSince(start);
+
+	benchSort(benchLatency, chunks);
+	printf("baud=%lu chunk=%u gap=%u goodput=%lu B/s corrupt=%lu/%lu timeouts=%lu/%lu p50=%lu us p90=%lu us p99=%lu us max=%lu us\r\n",
+			(unsigned long)baud, chunk, gap,
+			(unsigned long)(elapsed ? (uint64_t)goodBytes * 1000000u / elapsed : 0),
+			(unsigned long)corrupt, (unsigned long)chunks, (unsigned long)timeouts, (unsigned long)chunks,
+			(unsigned long)benchLatency[chunks * 50 / 100], (unsigned long)benchLatency[chunks * 90 / 100],
+			(unsigned long)benchLatency[chunks * 99 / 100], (unsigned long)benchLatency[chunks - 1]);
+}
+
+void runLinkBenchmark(void) {
+	HAL_NVIC_SetPriority(USART1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(USART1_IRQn);
+
+	printf("\r\n=== Link Benchmark (loopback PA9->PA10) ===\r\n");
+	for (size_t b = 0; b < sizeof(BENCH_BAUDS) / sizeof(BENCH_BAUDS[0]); b++) {
+		huart1.Init.BaudRate = BENCH_BAUDS[b];
+		if (HAL_UART_Init(&huart1) != HAL_OK) {
+			printf("baud=%lu init failed\r\n", (unsigned long)BENCH_BAUDS[b]);
+			continue;
+		}
+		for (size_t c = 0; c < sizeof(BENCH_CHUNKS) / sizeof(BENCH_CHUNKS[0]); c++) {
+			for (size_t g = 0; g < sizeof(BENCH_GAPS) / sizeof(BENCH_GAPS[0]); g++) {
+				benchRun(BENCH_BAUDS[b], BENCH_CHUNKS[c], BENCH_GAPS[g]);
+			}
+		}
+	}
+	printf("=== Benchmark complete ===\r\n");
+
+	// Back to the deployment baud rate
+	huart1.Init.BaudRate = 115200;
+	HAL_UART_Init(&huart1);
 }
 
 /**
@@ -385,11 +2228,22 @@ int main(void)
 	MX_GPIO_Init();
 	MX_I2C1_Init();
 	MX_USART2_UART_Init();  // Keep for debug output
-	MX_USART1_UART_Init();
+	ringInit(&logRing, logStorage, LOG_RING_SIZE);
+	MX_DMA_Init();
+	Link_Init();
+	enableCycleCounter();
+	catalogCheck();
+#if ENABLE_CHANNEL_BONDING
+	MX_USART6_UART_Init();
+#endif
 
 	/* Initialize LCD */
 	HD44780_Init(2);
 	HD44780_Clear();
+#if ENABLE_LINK_BENCHMARK
+	updateLCDStatus("Link Benchmark", "Running...");
+	runLinkBenchmark();
+#endif
 	updateLCDStatus("Text Selection", "System Ready");
 	HAL_Delay(2000);
 
@@ -413,7 +2267,7 @@ int main(void)
 			if (row >= 0 && row <= 2 && !inputReceived) {
 				switch (currentState) {
 				case INPUT_PARAGRAPH:
-					if (row < MAX_PARAGRAPHS) {
+					if (row < catalog->paragraphs) {
 						currentPos->paragraph = row;
 						updateInput("ENTER PARAGRAPH #", row);
 						snprintf(lcdBuffer, 16, "Para #%d", row);
@@ -423,7 +2277,7 @@ int main(void)
 					break;
 
 				case INPUT_LINE:
-					if (PARAGRAPHS[currentPos->paragraph][row] != NULL) {
+					if (catalogHasLine(currentPos->paragraph, row)) {
 						currentPos->line = row;
 						updateInput("ENTER LINE #", row);
 						snprintf(lcdBuffer, 16, "Line #%d", row);
@@ -451,11 +2305,25 @@ int main(void)
 						updateLCDStatus("End Index", "Enter Para #");
 					} else {
 						printSelectedText();
+#if ENABLE_BATCH_MODE
+						// Start over so the next selection can be queued
+						currentPos = &startPos;
+						currentState = INPUT_PARAGRAPH;
+						printPrompt("\nSTART INDEX", "ENTER PARAGRAPH #");
+#endif
 					}
 					inputReceived = 0;
 					break;
 				}
 			}
+#if ENABLE_BATCH_MODE
+			else if (row == 3 && !inputReceived && batchCount > 0 &&
+					currentState == INPUT_PARAGRAPH && currentPos == &startPos) {
+				// Idle ENTER at the start prompt flushes the queued batch
+				encryptBatch();
+				printPrompt("START INDEX", "ENTER PARAGRAPH #");
+			}
+#endif
 		}
 		else if (row == -1) {
 			buttonReleased = 1;
@@ -560,6 +2428,7 @@ static void MX_USART2_UART_Init(void)
 	HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 }
 
+#if LINK_TRANSPORT == TRANSPORT_UART
 /**
  * @brief USART2 Initialization Function
  * @param None
@@ -572,7 +2441,7 @@ static void MX_USART1_UART_Init(void)
 	huart1.Init.WordLength = UART_WORDLENGTH_8B;
 	huart1.Init.StopBits = UART_STOPBITS_1;
 	huart1.Init.Parity = UART_PARITY_NONE;
-	huart1.Init.Mode = UART_MODE_TX;  // TX only for encoder
+	huart1.Init.Mode = UART_MODE_TX_RX;  // RX carries the decoder's link status
 	huart1.Init.HwFlowCtl = UART_HWCONTROL_NONE;
 	huart1.Init.OverSampling = UART_OVERSAMPLING_16;
 
@@ -581,6 +2450,340 @@ static void MX_USART1_UART_Init(void)
 		Error_Handler();
 	}
 }
+#endif
+
+#if ENABLE_CHANNEL_BONDING
+/**
+ * @brief USART6 Initialization Function - second bonded port, TX on PC6
+ * @param None
+ * @retval None
+ */
+static void MX_USART6_UART_Init(void)
+{
+	__HAL_RCC_USART6_CLK_ENABLE();
+
+	huart6.Instance = USART6;
+	huart6.Init.BaudRate = 115200;
+	huart6.Init.WordLength = UART_WORDLENGTH_8B;
+	huart6.Init.StopBits = UART_STOPBITS_1;
+	huart6.Init.Parity = UART_PARITY_NONE;
+	huart6.Init.Mode = UART_MODE_TX;
+	huart6.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+	huart6.Init.OverSampling = UART_OVERSAMPLING_16;
+
+	if (HAL_UART_Init(&huart6) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	GPIO_InitStruct.Pin = GPIO_PIN_6;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+	GPIO_InitStruct.Alternate = GPIO_AF8_USART6;
+	HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+
+	HAL_NVIC_SetPriority(USART6_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(USART6_IRQn);
+}
+#endif
+
+#if LINK_TRANSPORT == TRANSPORT_SPI
+/**
+ * @brief SPI1 Initialization Function - transport master, SCK/MISO/MOSI on PA5/PA6/PA7
+ * 84 MHz APB2 / 16 gives a 5.25 Mbit/s link. TX runs on DMA2 Stream3 channel 3.
+ * @param None
+ * @retval None
+ */
+static void MX_SPI1_Init(void)
+{
+	__HAL_RCC_SPI1_CLK_ENABLE();
+	__HAL_RCC_DMA2_CLK_ENABLE();
+
+	hspi1.Instance = SPI1;
+	hspi1.Init.Mode = SPI_MODE_MASTER;
+	hspi1.Init.Direction = SPI_DIRECTION_2LINES;
+	hspi1.Init.DataSize = SPI_DATASIZE_8BIT;
+	hspi1.Init.CLKPolarity = SPI_POLARITY_LOW;
+	hspi1.Init.CLKPhase = SPI_PHASE_1EDGE;
+	hspi1.Init.NSS = SPI_NSS_SOFT;
+	hspi1.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_16;
+	hspi1.Init.FirstBit = SPI_FIRSTBIT_MSB;
+	hspi1.Init.TIMode = SPI_TIMODE_DISABLE;
+	hspi1.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+	hspi1.Init.CRCPolynomial = 10;
+	if (HAL_SPI_Init(&hspi1) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	GPIO_InitStruct.Pin = GPIO_PIN_5|GPIO_PIN_6|GPIO_PIN_7;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+	GPIO_InitStruct.Alternate = GPIO_AF5_SPI1;
+	HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+	hdma_spi1_tx.Instance = DMA2_Stream3;
+	hdma_spi1_tx.Init.Channel = DMA_CHANNEL_3;
+	hdma_spi1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_spi1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_spi1_tx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_spi1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_spi1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_spi1_tx.Init.Mode = DMA_NORMAL;
+	hdma_spi1_tx.Init.Priority = DMA_PRIORITY_HIGH;
+	hdma_spi1_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(&hdma_spi1_tx) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hspi1, hdmatx, hdma_spi1_tx);
+
+	HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Stream3_IRQn);
+	HAL_NVIC_SetPriority(SPI1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(SPI1_IRQn);
+}
+#endif
+
+void DMA2_Stream3_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_spi1_tx);
+}
+
+void SPI1_IRQHandler(void)
+{
+	HAL_SPI_IRQHandler(&hspi1);
+}
+
+#if CONTENT_STORE == STORE_SPI_NOR
+/**
+ * @brief SPI2 Initialization Function - content store NOR, SCK/MISO/MOSI on PB13/PB14/PB15, CS on PB12
+ * 42 MHz APB1 / 2 gives 21 MHz. Page reads run on DMA1 Stream3 channel 0; the
+ * HAL clocks a receive out of the TX side, so Stream4 channel 0 is linked too.
+ * @param None
+ * @retval None
+ */
+static void MX_SPI2_Init(void)
+{
+	__HAL_RCC_SPI2_CLK_ENABLE();
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	hspi2.Instance = SPI2;
+	hspi2.Init.Mode = SPI_MODE_MASTER;
+	hspi2.Init.Direction = SPI_DIRECTION_2LINES;
+	hspi2.Init.DataSize = SPI_DATASIZE_8BIT;
+	hspi2.Init.CLKPolarity = SPI_POLARITY_LOW;
+	hspi2.Init.CLKPhase = SPI_PHASE_1EDGE;
+	hspi2.Init.NSS = SPI_NSS_SOFT;
+	hspi2.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_2;
+	hspi2.Init.FirstBit = SPI_FIRSTBIT_MSB;
+	hspi2.Init.TIMode = SPI_TIMODE_DISABLE;
+	hspi2.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+	hspi2.Init.CRCPolynomial = 10;
+	if (HAL_SPI_Init(&hspi2) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	HAL_GPIO_WritePin(NOR_CS_PORT, NOR_CS_PIN, GPIO_PIN_SET);
+	GPIO_InitStruct.Pin = NOR_CS_PIN;
+	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+	HAL_GPIO_Init(NOR_CS_PORT, &GPIO_InitStruct);
+
+	GPIO_InitStruct.Pin = GPIO_PIN_13|GPIO_PIN_14|GPIO_PIN_15;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Alternate = GPIO_AF5_SPI2;
+	HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+	hdma_spi2_rx.Instance = DMA1_Stream3;
+	hdma_spi2_rx.Init.Channel = DMA_CHANNEL_0;
+	hdma_spi2_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_spi2_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_spi2_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_spi2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_spi2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_spi2_rx.Init.Mode = DMA_NORMAL;
+	hdma_spi2_rx.Init.Priority = DMA_PRIORITY_HIGH;
+	hdma_spi2_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(&hdma_spi2_rx) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hspi2, hdmarx, hdma_spi2_rx);
+
+	hdma_spi2_tx.Instance = DMA1_Stream4;
+	hdma_spi2_tx.Init = hdma_spi2_rx.Init;
+	hdma_spi2_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_spi2_tx.Init.Priority = DMA_PRIORITY_LOW;
+	if (HAL_DMA_Init(&hdma_spi2_tx) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&hspi2, hdmatx, hdma_spi2_tx);
+
+	HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream3_IRQn);
+	HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+	HAL_NVIC_SetPriority(SPI2_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(SPI2_IRQn);
+}
+
+void DMA1_Stream3_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_spi2_rx);
+}
+
+void DMA1_Stream4_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_spi2_tx);
+}
+
+void SPI2_IRQHandler(void)
+{
+	HAL_SPI_IRQHandler(&hspi2);
+}
+#elif CONTENT_STORE == STORE_SD
+/**
+ * @brief SDIO Initialization Function - content store SD card, D0-D3/CK on PC8-PC12, CMD on PD2
+ * Identification runs at 400 kHz; the 48 MHz PLLQ clock / (0 + 2) then gives
+ * 24 MHz on a 4-bit bus. Blocks are read by interrupt, leaving the DMA streams
+ * to the links.
+ * @param None
+ * @retval None
+ */
+static void MX_SDIO_SD_Init(void)
+{
+	__HAL_RCC_SDIO_CLK_ENABLE();
+	__HAL_RCC_GPIOD_CLK_ENABLE();
+
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	GPIO_InitStruct.Pin = GPIO_PIN_8|GPIO_PIN_9|GPIO_PIN_10|GPIO_PIN_11|GPIO_PIN_12;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+	GPIO_InitStruct.Alternate = GPIO_AF12_SDIO;
+	HAL_GPIO_Init(GPIOC, &GPIO_InitStruct);
+
+	GPIO_InitStruct.Pin = GPIO_PIN_2;
+	HAL_GPIO_Init(GPIOD, &GPIO_InitStruct);
+
+	hsd.Instance = SDIO;
+	hsd.Init.ClockEdge = SDIO_CLOCK_EDGE_RISING;
+	hsd.Init.ClockBypass = SDIO_CLOCK_BYPASS_DISABLE;
+	hsd.Init.ClockPowerSave = SDIO_CLOCK_POWER_SAVE_DISABLE;
+	hsd.Init.BusWide = SDIO_BUS_WIDE_1B;  // Widened once the card is identified
+	hsd.Init.HardwareFlowControl = SDIO_HARDWARE_FLOW_CONTROL_DISABLE;
+	hsd.Init.ClockDiv = 0;
+	if (HAL_SD_Init(&hsd) != HAL_OK)
+	{
+		printf("No SD card\r\n");
+		Error_Handler();
+	}
+	if (HAL_SD_ConfigWideBusOperation(&hsd, SDIO_BUS_WIDE_4B) != HAL_OK)
+	{
+		Error_Handler();
+	}
+
+	HAL_NVIC_SetPriority(SDIO_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(SDIO_IRQn);
+}
+
+void SDIO_IRQHandler(void)
+{
+	HAL_SD_IRQHandler(&hsd);
+}
+#endif
+
+/* Configure one memory-to-peripheral DMA stream and link it to a UART */
+static void linkTxDMA(UART_HandleTypeDef* huart, DMA_HandleTypeDef* hdma,
+		DMA_Stream_TypeDef* stream, uint32_t channel)
+{
+	hdma->Instance = stream;
+	hdma->Init.Channel = channel;
+	hdma->Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma->Init.MemInc = DMA_MINC_ENABLE;
+	hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma->Init.Mode = DMA_NORMAL;
+	hdma->Init.Priority = DMA_PRIORITY_HIGH;
+	hdma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(hdma) != HAL_OK)
+	{
+		Error_Handler();
+	}
+	__HAL_LINKDMA(huart, hdmatx, *hdma);
+}
+
+/**
+ * @brief DMA Initialization Function
+ * USART1_TX is DMA2 Stream7 channel 4, USART6_TX is DMA2 Stream6 channel 5,
+ * USART2_TX (debug log) is DMA1 Stream6 channel 4.
+ * @param None
+ * @retval None
+ */
+static void MX_DMA_Init(void)
+{
+	__HAL_RCC_DMA1_CLK_ENABLE();
+	__HAL_RCC_DMA2_CLK_ENABLE();
+
+	linkTxDMA(&huart2, &hdma_usart2_tx, DMA1_Stream6, DMA_CHANNEL_4);
+	HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 6, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+	HAL_NVIC_SetPriority(USART2_IRQn, 6, 0);
+	HAL_NVIC_EnableIRQ(USART2_IRQn);
+
+	linkTxDMA(&huart1, &hdma_usart1_tx, DMA2_Stream7, DMA_CHANNEL_4);
+	HAL_NVIC_SetPriority(DMA2_Stream7_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+
+#if ENABLE_CHANNEL_BONDING
+	linkTxDMA(&huart6, &hdma_usart6_tx, DMA2_Stream6, DMA_CHANNEL_5);
+	HAL_NVIC_SetPriority(DMA2_Stream6_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Stream6_IRQn);
+#endif
+	HAL_NVIC_SetPriority(USART1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(USART1_IRQn);
+}
+
+/* Interrupt handlers for the DMA-driven ports */
+void DMA1_Stream6_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_usart2_tx);
+}
+
+void USART2_IRQHandler(void)
+{
+	HAL_UART_IRQHandler(&huart2);
+}
+
+void DMA2_Stream7_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_usart1_tx);
+}
+
+void DMA2_Stream6_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_usart6_tx);
+}
+
+void USART1_IRQHandler(void)
+{
+	HAL_UART_IRQHandler(&huart1);
+}
+
+void USART6_IRQHandler(void)
+{
+	HAL_UART_IRQHandler(&huart6);
+}
 
 /**
  * @brief GPIO Initialization Function
@@ -618,12 +2821,22 @@ static void MX_GPIO_Init(void)
 	HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 
 	/* Configure UART pins */
-	GPIO_InitStruct.Pin = GPIO_PIN_9;  // PA9 is TX for UART1
+	GPIO_InitStruct.Pin = GPIO_PIN_9|GPIO_PIN_10;  // PA9 is TX, PA10 is RX for UART1
 	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
 	GPIO_InitStruct.Pull = GPIO_NOPULL;
 	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
 	GPIO_InitStruct.Alternate = GPIO_AF7_USART1;
 	HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+
+#if ENABLE_BROADCAST_MODE
+	/* RS-485 transceiver: the encoder is the only talker, keep the driver enabled */
+	GPIO_InitStruct.Pin = RS485_DE_PIN;
+	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+	HAL_GPIO_Init(RS485_DE_PORT, &GPIO_InitStruct);
+	HAL_GPIO_WritePin(RS485_DE_PORT, RS485_DE_PIN, GPIO_PIN_SET);
+#endif
 }
 
 /**
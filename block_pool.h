@@ -0,0 +1,149 @@
+/* Block pool - message buffers for the decoders come from here instead of
+ * the heap. Fixed-size block classes are carved out of static storage. Each
+ * class keeps a free list threaded through its free blocks, so allocation and
+ * release are O(1), nothing fragments, and running out is reported instead of
+ * hanging.
+ *
+ * Included once per image, after MAX_DATA_SIZE and POOL_BOARD are defined:
+ * FINAL_DECODER.c, lcd_communication_decode.c and tools/pool_soak.c, which
+ * soaks exactly this code with a board's configuration. Error_Handler() is
+ * the includer's. */
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Per-board configuration */
+#define POOL_BOARD_FINAL_DECODER 0  // FINAL_DECODER.c
+#define POOL_BOARD_LCD_DECODE 1     // lcd_communication_decode.c
+
+#if !defined(POOL_BOARD) || !defined(MAX_DATA_SIZE)
+#error "Define POOL_BOARD and MAX_DATA_SIZE before including block_pool.h"
+#endif
+
+#define POOL_SMALL_SIZE 256
+#define POOL_SMALL_COUNT 4
+#define POOL_MEDIUM_SIZE 2048
+#define POOL_MEDIUM_COUNT 2
+#define POOL_LARGE_SIZE (MAX_DATA_SIZE + 4)  // Room for a terminator, word aligned
+
+#if POOL_BOARD == POOL_BOARD_FINAL_DECODER
+#define POOL_LARGE_COUNT 2  // A compressed frame holds its payload and the text it inflates to
+#elif POOL_BOARD == POOL_BOARD_LCD_DECODE
+#define POOL_LARGE_COUNT 1  // No compressed frames - the payload is the text
+#else
+#error "Unknown POOL_BOARD"
+#endif
+
+/* Blocks hold the free-list pointer, so the stride is pointer aligned. That
+ * is the block size itself on the target; 8-byte host pointers round it up. */
+#define POOL_STRIDE(size) (((size) + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*))
+
+typedef struct {
+	uint32_t block_size;
+	uint16_t block_count;
+	uint8_t* storage;
+	void* free_list;
+	uint16_t in_use;
+	uint16_t peak;
+} PoolClass;
+
+typedef struct {
+	uint32_t allocations;
+	uint32_t failures;
+	uint32_t bytes_in_use;
+	uint32_t peak_bytes;
+} PoolStats;
+
+void Error_Handler(void);
+
+static uint8_t poolSmall[POOL_SMALL_COUNT][POOL_STRIDE(POOL_SMALL_SIZE)] __attribute__((aligned(sizeof(void*))));
+static uint8_t poolMedium[POOL_MEDIUM_COUNT][POOL_STRIDE(POOL_MEDIUM_SIZE)] __attribute__((aligned(sizeof(void*))));
+static uint8_t poolLarge[POOL_LARGE_COUNT][POOL_STRIDE(POOL_LARGE_SIZE)] __attribute__((aligned(sizeof(void*))));
+
+static PoolClass poolClasses[] = {
+	{.block_size = POOL_STRIDE(POOL_SMALL_SIZE), .block_count = POOL_SMALL_COUNT, .storage = &poolSmall[0][0]},
+	{.block_size = POOL_STRIDE(POOL_MEDIUM_SIZE), .block_count = POOL_MEDIUM_COUNT, .storage = &poolMedium[0][0]},
+	{.block_size = POOL_STRIDE(POOL_LARGE_SIZE), .block_count = POOL_LARGE_COUNT, .storage = &poolLarge[0][0]}
+};
+
+#define POOL_CLASSES (sizeof(poolClasses) / sizeof(poolClasses[0]))
+
+static PoolStats poolStats = {0};
+
+static void poolInit(void) {
+	for (size_t c = 0; c < POOL_CLASSES; c++) {
+		PoolClass* pc = &poolClasses[c];
+		pc->free_list = NULL;
+		for (int b = pc->block_count - 1; b >= 0; b--) {
+			void** block = (void**)&pc->storage[(uint32_t)b * pc->block_size];
+			*block = pc->free_list;
+			pc->free_list = block;
+		}
+		pc->in_use = 0;
+		pc->peak = 0;
+	}
+	memset(&poolStats, 0, sizeof(poolStats));
+}
+
+/* Smallest free block that holds size bytes, or NULL when none is left */
+static void* poolAlloc(size_t size) {
+	for (size_t c = 0; c < POOL_CLASSES; c++) {
+		PoolClass* pc = &poolClasses[c];
+		if (size > pc->block_size || pc->free_list == NULL) {
+			continue;
+		}
+
+		void** block = pc->free_list;
+		pc->free_list = *block;
+		if (++pc->in_use > pc->peak) {
+			pc->peak = pc->in_use;
+		}
+		poolStats.allocations++;
+		poolStats.bytes_in_use += pc->block_size;
+		if (poolStats.bytes_in_use > poolStats.peak_bytes) {
+			poolStats.peak_bytes = poolStats.bytes_in_use;
+		}
+		return block;
+	}
+	poolStats.failures++;
+	return NULL;
+}
+
+static void poolFree(void* ptr) {
+	if (ptr == NULL) {
+		return;
+	}
+	for (size_t c = 0; c < POOL_CLASSES; c++) {
+		PoolClass* pc = &poolClasses[c];
+		uint32_t offset = (uint8_t*)ptr - pc->storage;
+		if ((uint8_t*)ptr < pc->storage || offset >= (uint32_t)pc->block_count * pc->block_size) {
+			continue;
+		}
+		if (offset % pc->block_size != 0) {
+			Error_Handler();  // Not a block start - corrupt pointer
+		}
+
+		*(void**)ptr = pc->free_list;
+		pc->free_list = ptr;
+		pc->in_use--;
+		poolStats.bytes_in_use -= pc->block_size;
+		return;
+	}
+	Error_Handler();  // Not from the pool
+}
+
+/* Pool usage on the debug port */
+static void poolReport(void) {
+	printf("Pool: %lu bytes in use, peak %lu, %lu allocations, %lu failures\r\n",
+			(unsigned long)poolStats.bytes_in_use, (unsigned long)poolStats.peak_bytes,
+			(unsigned long)poolStats.allocations, (unsigned long)poolStats.failures);
+	for (size_t c = 0; c < POOL_CLASSES; c++) {
+		printf("  %5lu B x %u: %u in use, peak %u\r\n", (unsigned long)poolClasses[c].block_size,
+				poolClasses[c].block_count, poolClasses[c].in_use, poolClasses[c].peak);
+	}
+}
+
+#endif /* BLOCK_POOL_H */
@@ -0,0 +1,186 @@
+/* Channel bonding - a payload striped over BOND_PORTS UARTs. Chunk k goes out
+ * on port k % BOND_PORTS behind a header of its sequence number (LE16) and
+ * length, so the receiver can place it whatever the skew between ports.
+ *
+ * The wire format is shared by FINAL_ENCODER.c and FINAL_DECODER.c. With
+ * BOND_RECEIVE set the reassembly is included as well: FINAL_DECODER.c and
+ * tools/bond_reassembly.c, which runs exactly this code against simulated
+ * UARTs. The includer defines BOND_PORTS, BOND_CHUNK_SIZE and BOND_HEADER_SIZE
+ * and, for the reassembly, BOND_RX_TIMEOUT and the bondPorts[] table, and
+ * provides the HAL types and calls. Optional hooks:
+ *
+ *   BOND_RING_PORT     Port whose chunks come out of a receive ring instead
+ *                      of a per-chunk DMA; the includer provides
+ *                      bondRingRead(frame, length), HAL_BUSY until it has
+ *                      the whole frame
+ *   BOND_RX_PREFIX(n)  Called as chunks land with the length of the payload
+ *                      prefix that has fully arrived */
+#ifndef CHANNEL_BOND_H
+#define CHANNEL_BOND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if !defined(BOND_PORTS) || !defined(BOND_CHUNK_SIZE) || !defined(BOND_HEADER_SIZE)
+#error "Define BOND_PORTS, BOND_CHUNK_SIZE and BOND_HEADER_SIZE before including channel_bond.h"
+#endif
+
+static inline void bondPackHeader(uint8_t* header, uint16_t seq, uint8_t length) {
+	header[0] = (uint8_t)(seq & 0xFF);
+	header[1] = (uint8_t)((seq >> 8) & 0xFF);
+	header[2] = length;
+}
+
+/* Header plus payload bytes of chunk seq of a size-byte payload */
+static inline uint16_t bondFrameLength(uint16_t seq, uint32_t size) {
+	uint32_t remaining = size - (uint32_t)seq * BOND_CHUNK_SIZE;
+	return BOND_HEADER_SIZE + ((remaining > BOND_CHUNK_SIZE) ? BOND_CHUNK_SIZE : remaining);
+}
+
+#if BOND_RECEIVE
+#ifndef BOND_RX_TIMEOUT
+#error "Define BOND_RX_TIMEOUT before including channel_bond.h with BOND_RECEIVE"
+#endif
+
+/* Each port double-buffers so the next chunk is armed from the callback */
+typedef struct {
+	uint8_t frame[2][BOND_HEADER_SIZE + BOND_CHUNK_SIZE];
+	volatile bool ready[2];
+	volatile uint8_t active;      // Buffer the DMA is filling
+	volatile uint16_t armed_seq;  // Sequence number the DMA is receiving
+	volatile bool error;
+	uint8_t consume;              // Next buffer the main loop reads
+	uint16_t next_seq;            // Next sequence number the main loop expects
+	uint32_t last_activity;
+} BondRxPort;
+
+static BondRxPort bondRx[BOND_PORTS];
+static uint32_t bondRxSize = 0;
+static uint16_t bondRxChunks = 0;
+
+#ifdef BOND_RING_PORT
+static HAL_StatusTypeDef bondRingRead(uint8_t* frame, uint16_t length);
+#define BOND_DMA_PORT(huart) ((huart) != BOND_RING_PORT)
+#else
+#define BOND_DMA_PORT(huart) true
+#endif
+
+/* From HAL_UART_RxCpltCallback - a port's frame is in, arm its next one */
+static void bondRxComplete(UART_HandleTypeDef* huart) {
+	for(int i = 0; i < BOND_PORTS; i++) {
+		if(bondPorts[i] != huart) {
+			continue;
+		}
+
+		BondRxPort* port = &bondRx[i];
+		uint16_t next = port->armed_seq + BOND_PORTS;
+
+		port->ready[port->active] = true;
+		port->active ^= 1;
+		if(next < bondRxChunks) {
+			// The main loop has not drained the other buffer yet - chunk would be lost
+			if(port->ready[port->active]) {
+				port->error = true;
+				return;
+			}
+			port->armed_seq = next;
+			HAL_UART_Receive_DMA(huart, port->frame[port->active], bondFrameLength(next, bondRxSize));
+		}
+	}
+}
+
+/* From HAL_UART_ErrorCallback - the HAL has stopped the port's DMA */
+static void bondRxError(UART_HandleTypeDef* huart) {
+	for(int i = 0; i < BOND_PORTS; i++) {
+		if(bondPorts[i] == huart) {
+			bondRx[i].error = true;
+		}
+	}
+}
+
+static void abortBonded(void) {
+	for(int i = 0; i < BOND_PORTS; i++) {
+		if(BOND_DMA_PORT(bondPorts[i])) {
+			HAL_UART_AbortReceive(bondPorts[i]);
+		}
+	}
+}
+
+/* Reassemble a payload striped over the bonded ports. Chunk k arrives on port
+ * k % BOND_PORTS, so ports may run ahead of each other; the sequence number in
+ * each chunk places it in dest. A port that stalls or errors fails the frame. */
+HAL_StatusTypeDef receiveBonded(uint8_t* dest, uint32_t size) {
+	uint16_t chunks_done = 0;
+
+	bondRxSize = size;
+	bondRxChunks = (size + BOND_CHUNK_SIZE - 1) / BOND_CHUNK_SIZE;
+
+	// Arm every port for its first chunk
+	for(int i = 0; i < BOND_PORTS; i++) {
+		BondRxPort* port = &bondRx[i];
+		memset(port, 0, sizeof(BondRxPort));
+		port->armed_seq = i;
+		port->next_seq = i;
+		port->last_activity = HAL_GetTick();
+		if(i < bondRxChunks && BOND_DMA_PORT(bondPorts[i])) {
+			HAL_UART_Receive_DMA(bondPorts[i], port->frame[0], bondFrameLength(i, size));
+		}
+	}
+
+	while(chunks_done < bondRxChunks) {
+		for(int i = 0; i < BOND_PORTS; i++) {
+			BondRxPort* port = &bondRx[i];
+
+			if(port->next_seq >= bondRxChunks) {
+				continue;
+			}
+#ifdef BOND_RING_PORT
+			if(bondPorts[i] == BOND_RING_PORT && !port->ready[port->consume]) {
+				HAL_StatusTypeDef ring = bondRingRead(port->frame[port->consume], bondFrameLength(port->next_seq, size));
+				port->ready[port->consume] = (ring == HAL_OK);
+				port->error = (ring != HAL_OK && ring != HAL_BUSY);
+			}
+#endif
+			if(port->error || HAL_GetTick() - port->last_activity > BOND_RX_TIMEOUT) {
+				printf("Bonded port %d failed waiting for chunk %u\r\n", i, port->next_seq);
+				abortBonded();
+				return HAL_ERROR;
+			}
+			if(!port->ready[port->consume]) {
+				continue;
+			}
+
+			uint8_t* frame = port->frame[port->consume];
+			uint16_t seq = frame[0] | (frame[1] << 8);
+			uint8_t length = frame[2];
+			if(seq != port->next_seq || BOND_HEADER_SIZE + length != bondFrameLength(seq, size)) {
+				printf("Bonded port %d out of sync: got chunk %u, expected %u\r\n", i, seq, port->next_seq);
+				abortBonded();
+				return HAL_ERROR;
+			}
+
+			memcpy(&dest[(uint32_t)seq * BOND_CHUNK_SIZE], &frame[BOND_HEADER_SIZE], length);
+			port->ready[port->consume] = false;
+			port->consume ^= 1;
+			port->next_seq += BOND_PORTS;
+			port->last_activity = HAL_GetTick();
+			chunks_done++;
+
+#ifdef BOND_RX_PREFIX
+			// Every chunk below the lowest expected sequence number has arrived
+			uint32_t prefix = bondRxChunks;
+			for(int k = 0; k < BOND_PORTS; k++) {
+				if(bondRx[k].next_seq < prefix) prefix = bondRx[k].next_seq;
+			}
+			prefix *= BOND_CHUNK_SIZE;
+			BOND_RX_PREFIX((prefix < size) ? prefix : size);
+#endif
+		}
+	}
+	return HAL_OK;
+}
+#endif /* BOND_RECEIVE */
+
+#endif /* CHANNEL_BOND_H */
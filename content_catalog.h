@@ -0,0 +1,31 @@
+/* Content catalog - generated by tools/pack_catalog.py from content/, do not edit.
+ * 3 paragraphs, 246 bytes:
+ *   0  00-derivative.txt
+ *   1  01-inertia.txt
+ *   2  02-determinant.txt
+ */
+#ifndef CONTENT_CATALOG_H
+#define CONTENT_CATALOG_H
+
+#include <stdint.h>
+
+static const uint8_t CONTENT_CATALOG[246] __attribute__((aligned(4))) = {
+	0x43, 0x43, 0x41, 0x54, 0x02, 0x00, 0x03, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x04, 0x01, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x25, 0x00, 0x00, 0x00, 0x41, 0x00, 0x00, 0x00, 0x72, 0x00, 0x00, 0x00,
+	0x7F, 0x00, 0x00, 0x00, 0xC3, 0x00, 0x00, 0x00, 0xF7, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0xB2, 0x00, 0x00, 0x00, 0xFC, 0x17, 0x1C, 0x57, 0x68, 0x61, 0x74, 0x20, 0x69, 0x73, 0x20, 0x74,
+	0x68, 0x65, 0x20, 0x64, 0x65, 0x72, 0x69, 0x76, 0x61, 0x74, 0x69, 0x76, 0x65, 0x20, 0x6F, 0x66,
+	0x20, 0x32, 0x78, 0x5E, 0x33, 0x20, 0x2B, 0x20, 0x33, 0x78, 0x3F, 0x00, 0x54, 0x01, 0x2E, 0x42,
+	0x1C, 0x36, 0x78, 0x5E, 0x32, 0x2A, 0x40, 0x2E, 0x00, 0x62, 0x3C, 0x6D, 0x6F, 0x6D, 0x65, 0x6E,
+	0x74, 0x72, 0x0A, 0x69, 0x6E, 0x65, 0x72, 0x74, 0x69, 0x61, 0xF2, 0x0C, 0x3D, 0x61, 0x20, 0x72,
+	0x6F, 0x6C, 0x6C, 0x69, 0x6E, 0x67, 0x20, 0x64, 0x69, 0x73, 0x6B, 0x3F, 0x00, 0x49, 0x20, 0x3D,
+	0x20, 0x31, 0x2F, 0x32, 0x4D, 0x52, 0x5E, 0x32, 0x25, 0x7B, 0x65, 0x6E, 0x71, 0x3F, 0x74, 0x65,
+	0x72, 0x6D, 0x69, 0x6E, 0x61, 0xF7, 0x05, 0x62, 0x64, 0x6F, 0x65, 0x73, 0x20, 0x6E, 0x6F, 0x74,
+	0x20, 0x65, 0x71, 0x75, 0x61, 0x6C, 0x20, 0x74, 0x6F, 0x20, 0x30, 0x2C, 0x51, 0x5F, 0x61, 0x74,
+	0x72, 0x69, 0x78, 0x12, 0x60, 0x76, 0x34, 0x9D, 0x62, 0x6C, 0x65, 0x06, 0x16, 0x11, 0x19, 0x73,
+	0x49, 0x20, 0x64, 0x65, 0x65, 0x64, 0x36, 0x61, 0x20, 0x69, 0x66, 0xA0, 0x28, 0x41, 0x29, 0x20,
+	0x21, 0x3D, 0x20, 0x30, 0x2E, 0x00,
+};
+
+#endif /* CONTENT_CATALOG_H */
@@ -11,24 +11,69 @@
 #define LCD_COLS 16
 #define LCD_ROWS 2
 #define SCROLL_DELAY 2000  // 2 seconds per line
+#define ENABLE_DECRYPT_ON_RECEIVE 1  // Decrypt each DMA half-block as it lands
+#define RX_BLOCK_SIZE 256            // Payload DMA block, decrypted a half at a time
+#define RX_STALL_TIMEOUT 1000        // ms without DMA progress before the frame is dropped
+#define ENABLE_LCD_STREAMING 1       // Show lines on the LCD while the rest is still arriving
+
+/* Block pool - message buffers come from here instead of the heap */
+#define POOL_BOARD POOL_BOARD_LCD_DECODE  // Block sizes and counts are in block_pool.h
+
+#if ENABLE_LCD_STREAMING && !ENABLE_DECRYPT_ON_RECEIVE
+#error "LCD streaming needs ENABLE_DECRYPT_ON_RECEIVE"
+#endif
 
 /* Private variables ---------------------------------------------------------*/
 UART_HandleTypeDef huart1;  // For receiving data
 UART_HandleTypeDef huart2;  // For debug output
 I2C_HandleTypeDef hi2c1;
+DMA_HandleTypeDef hdma_usart1_rx;
+
+/* Payload DMA - received in RX_BLOCK_SIZE blocks, each re-armed from the
+ * complete callback. rxLanded is how much has arrived, published on the
+ * half-transfer and complete events. */
+static uint8_t *rxData = NULL;
+static uint32_t rxTotal = 0;
+static uint32_t rxBlockStart = 0;
+static uint16_t rxBlockLength = 0;
+static volatile uint32_t rxLanded = 0;
+static volatile uint8_t rxError = 0;
+
+/* Keystream state, so data can be decrypted a piece at a time */
+typedef struct {
+	uint8_t key[KEY_SIZE];
+	uint8_t keyStream[KEY_SIZE];
+	size_t position;
+} DecryptStream;
+
+/* LCD streaming - the next line to show and when the last one went up */
+typedef struct {
+	const char* text;
+	size_t offset;
+	int line_count;
+	uint32_t last_shown;
+	uint32_t frame_start;  // Tick of the start marker, for time-to-first-line
+} LcdStream;
+
+static LcdStream lcdStream;
+static uint32_t firstLineTick = 0;  // Tick the first line went up without streaming
 
 /* Function Prototypes ------------------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
 static void MX_USART1_UART_Init(void);
 static void MX_USART2_UART_Init(void);
+static void MX_DMA_Init(void);
 void Error_Handler(void);
 void deriveKeyFromAccessKey(const uint8_t* access_key, uint32_t timestamp, uint8_t* key);
 void decryptData(uint8_t* data, size_t length, const uint8_t* key);
 void MX_I2C1_Init(void);
 void displayTextOnLCD(const char* text, size_t length);
+void lcdStreamPoll(LcdStream* stream, size_t available, size_t total);
+void lcdShowError(const char* reason);
 
-
+/* Block Pool */
+#include "block_pool.h"  // Shared with tools/pool_soak.c
 
 /* Decryption functions */
 void deriveKeyFromAccessKey(const uint8_t* access_key, uint32_t timestamp, uint8_t* key) {
@@ -38,18 +83,103 @@ void deriveKeyFromAccessKey(const uint8_t* access_key, uint32_t timestamp, uint8
 	}
 }
 
-void decryptData(uint8_t* data, size_t length, const uint8_t* key) {
-	uint8_t keyStream[KEY_SIZE];
-	memcpy(keyStream, key, KEY_SIZE);
+void decryptInit(DecryptStream* stream, const uint8_t* key) {
+	memcpy(stream->key, key, KEY_SIZE);
+	memcpy(stream->keyStream, key, KEY_SIZE);
+	stream->position = 0;
+}
 
-	for(size_t i = 0; i < length; i++) {
+/* Decrypt the next length bytes of the stream in place */
+void decryptUpdate(DecryptStream* stream, uint8_t* data, size_t length) {
+	for(size_t n = 0; n < length; n++) {
+		size_t i = stream->position++;
 		if(i > 0 && (i % KEY_SIZE) == 0) {
 			for(int j = 0; j < KEY_SIZE; j++) {
-				keyStream[j] = keyStream[j] ^ key[j] ^ (i & 0xFF);
+				stream->keyStream[j] = stream->keyStream[j] ^ stream->key[j] ^ (i & 0xFF);
 			}
 		}
-		data[i] ^= keyStream[i % KEY_SIZE];
+		data[n] ^= stream->keyStream[i % KEY_SIZE];
+	}
+}
+
+void decryptData(uint8_t* data, size_t length, const uint8_t* key) {
+	DecryptStream stream;
+	decryptInit(&stream, key);
+	decryptUpdate(&stream, data, length);
+}
+
+/* Payload DMA */
+static void rxArmBlock(void) {
+	uint32_t remaining = rxTotal - rxBlockStart;
+	rxBlockLength = (remaining > RX_BLOCK_SIZE) ? RX_BLOCK_SIZE : remaining;
+	if (HAL_UART_Receive_DMA(&huart1, rxData + rxBlockStart, rxBlockLength) != HAL_OK) {
+		rxError = 1;
+	}
+}
+
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart) {
+	if (huart == &huart1) {
+		rxLanded = rxBlockStart + rxBlockLength / 2;
+	}
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
+	if (huart == &huart1) {
+		rxBlockStart += rxBlockLength;
+		rxLanded = rxBlockStart;
+		if (rxBlockStart < rxTotal) {
+			rxArmBlock();
+		}
+	}
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+	if (huart == &huart1) {
+		rxError = 1;
+	}
+}
+
+/* Receive size bytes into data by DMA. With ENABLE_DECRYPT_ON_RECEIVE each
+ * half-block is decrypted while the next one is still on the wire, so only
+ * the last half-block is left when the transfer completes. */
+HAL_StatusTypeDef receivePayload(uint8_t* data, uint32_t size, DecryptStream* stream) {
+	uint32_t decrypted = 0;
+	uint32_t lastLanded = 0;
+	uint32_t lastProgress = HAL_GetTick();
+
+	rxData = data;
+	rxTotal = size;
+	rxBlockStart = 0;
+	rxLanded = 0;
+	rxError = 0;
+	rxArmBlock();
+
+	while (rxLanded < size) {
+		if (rxError) {
+			HAL_UART_AbortReceive(&huart1);
+			return HAL_ERROR;
+		}
+		uint32_t landed = rxLanded;
+		if (landed != lastLanded) {
+			lastLanded = landed;
+			lastProgress = HAL_GetTick();
+#if ENABLE_DECRYPT_ON_RECEIVE
+			decryptUpdate(stream, data + decrypted, landed - decrypted);
+			decrypted = landed;
+#endif
+		} else if (HAL_GetTick() - lastProgress > RX_STALL_TIMEOUT) {
+			HAL_UART_AbortReceive(&huart1);
+			printf("Error receiving data at byte %lu\r\n", (unsigned long)landed);
+			return HAL_TIMEOUT;
+		}
+#if ENABLE_LCD_STREAMING
+		// Every pass, so a complete line goes up as soon as its SCROLL_DELAY
+		// is over rather than at the next DMA event. The DMA keeps landing
+		// blocks while the LCD is written.
+		lcdStreamPoll(&lcdStream, decrypted, size);
+#endif
 	}
+	return HAL_OK;
 }
 
 /* UART receive function */
@@ -74,6 +204,13 @@ int main(void) {
 	MX_I2C1_Init();  // Add I2C initialization
 	MX_USART1_UART_Init();
 	MX_USART2_UART_Init();
+	MX_DMA_Init();
+	poolInit();
+
+	// Cycle counter for the decrypt latency figure
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
 
 	// Initialize LCD
 	HD44780_Init(2);
@@ -107,6 +244,7 @@ int main(void) {
 			status = HAL_UART_Receive(&huart1, &startMarker, 1, 100);
 			if (status != HAL_OK) continue;
 		}
+		uint32_t frameStart = HAL_GetTick();
 		printf("Received start marker: 0x%02X\r\n", startMarker);
 		HAL_Delay(50);
 
@@ -149,50 +287,48 @@ int main(void) {
 
 		// 5. Allocate memory for encrypted data
 		printf("Allocating memory for data...\r\n");
-		encrypted_data = malloc(data_size);
+		encrypted_data = poolAlloc(data_size);
 		if (encrypted_data == NULL) {
-			printf("Memory allocation failed\r\n");
+			printf("No pool block for %lu bytes\r\n", (unsigned long)data_size);
 			continue;
 		}
 
-		// 6. Receive encrypted data
+		// 6. Receive encrypted data, the key is known so decryption can run alongside
 		printf("Receiving encrypted data...\r\n");
-		size_t received = 0;
-		while (received < data_size) {
-			uint16_t chunk_size = (data_size - received > 32) ? 32 : data_size - received;
-			status = UART_Receive_Safe(&huart1, encrypted_data + received, chunk_size, 1000);
-
-			if (status != HAL_OK) {
-				printf("Error receiving data at byte %zu\r\n", received);
-				break;
-			}
-
-			received += chunk_size;
-			if (received % 128 == 0 || received == data_size) {
-				printf("Received %zu of %lu bytes\r\n", received, (unsigned long)data_size);
-			}
-			HAL_Delay(1);
-		}
-
-		if (received != data_size) {
+		DecryptStream stream;
+		deriveKeyFromAccessKey(access_key, timestamp, key);
+		decryptInit(&stream, key);
+#if ENABLE_LCD_STREAMING
+		memset(&lcdStream, 0, sizeof(lcdStream));
+		lcdStream.text = (const char*)encrypted_data;
+		lcdStream.frame_start = frameStart;
+#endif
+
+		status = receivePayload(encrypted_data, data_size, &stream);
+		if (status != HAL_OK) {
 			printf("Failed to receive complete data\r\n");
-			free(encrypted_data);
+			lcdShowError("Data incomplete");
+			poolFree(encrypted_data);
 			continue;
 		}
+		printf("Received %lu bytes\r\n", (unsigned long)data_size);
 
 		// 7. Wait for end marker
 		uint8_t endMarker;
 		status = UART_Receive_Safe(&huart1, &endMarker, 1, 1000);
 		if (status != HAL_OK || endMarker != 0x55) {
 			printf("Invalid end marker\r\n");
-			free(encrypted_data);
+			lcdShowError("Bad end marker");
+			poolFree(encrypted_data);
 			continue;
 		}
+		uint32_t endMarkerCycles = DWT->CYCCNT;
 
-		// 8. Decrypt the data
-		printf("\r\nDecrypting data...\r\n");
-		deriveKeyFromAccessKey(access_key, timestamp, key);
-		decryptData(encrypted_data, data_size, key);
+		// 8. Decrypt whatever is left - the last half-block, or all of it without the pipeline
+		decryptUpdate(&stream, encrypted_data + stream.position, data_size - stream.position);
+		printf("\r\nEnd marker to plaintext: %lu us (%s)\r\n",
+				(unsigned long)((DWT->CYCCNT - endMarkerCycles) / (SystemCoreClock / 1000000u)),
+				ENABLE_DECRYPT_ON_RECEIVE ? "decrypt on receive" : "decrypt after receive");
 
 		printf("\r\n=== Decryption Summary ============================\r\n");
 		printf("Access Key: %s\r\n", access_key);
@@ -221,10 +357,24 @@ int main(void) {
 		printf("================================================\r\n\n");
 
 		// Display on LCD
+#if ENABLE_LCD_STREAMING
+		// Lines already shown while receiving stay shown, the rest follow at SCROLL_DELAY
+		while (lcdStream.offset < data_size) {
+			lcdStreamPoll(&lcdStream, data_size, data_size);
+		}
+		HAL_Delay(SCROLL_DELAY);
+		HD44780_Clear();
+		HD44780_SetCursor(0,0);
+		HD44780_PrintStr("End of Message");
+		HAL_Delay(SCROLL_DELAY);
+#else
 		displayTextOnLCD((char*)encrypted_data, data_size);
+		printf("Time to first line: %lu ms\r\n", (unsigned long)(firstLineTick - frameStart));
+#endif
 
 		// Cleanup and continue as before
-		free(encrypted_data);
+		poolFree(encrypted_data);
+		poolReport();
 		printf("Ready for next transmission...\r\n\n");
 
 		// Show ready message on LCD
@@ -252,6 +402,39 @@ static void MX_USART1_UART_Init(void) {
 	}
 }
 
+/* DMA Initialization - USART1_RX is DMA2 Stream2 channel 4 */
+static void MX_DMA_Init(void) {
+	__HAL_RCC_DMA2_CLK_ENABLE();
+
+	hdma_usart1_rx.Instance = DMA2_Stream2;
+	hdma_usart1_rx.Init.Channel = DMA_CHANNEL_4;
+	hdma_usart1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_usart1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_usart1_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_usart1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_usart1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_usart1_rx.Init.Mode = DMA_NORMAL;
+	hdma_usart1_rx.Init.Priority = DMA_PRIORITY_HIGH;
+	hdma_usart1_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	if (HAL_DMA_Init(&hdma_usart1_rx) != HAL_OK) {
+		Error_Handler();
+	}
+	__HAL_LINKDMA(&huart1, hdmarx, hdma_usart1_rx);
+
+	HAL_NVIC_SetPriority(DMA2_Stream2_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(DMA2_Stream2_IRQn);
+	HAL_NVIC_SetPriority(USART1_IRQn, 5, 0);
+	HAL_NVIC_EnableIRQ(USART1_IRQn);
+}
+
+void DMA2_Stream2_IRQHandler(void) {
+	HAL_DMA_IRQHandler(&hdma_usart1_rx);
+}
+
+void USART1_IRQHandler(void) {
+	HAL_UART_IRQHandler(&huart1);
+}
+
 /* USART2 Initialization Function */
 static void MX_USART2_UART_Init(void) {
 	huart2.Instance = USART2;
@@ -301,10 +484,82 @@ static void MX_GPIO_Init(void) {
 	HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 }
 
+/* Length of the LCD line starting at text, at most LCD_COLS and stopping at a newline */
+static size_t lcdLineLength(const char* text, size_t remaining) {
+	size_t line_length = 0;
+	while (line_length < LCD_COLS &&
+			line_length < remaining &&
+			text[line_length] != '\n') {
+		line_length++;
+	}
+	return line_length;
+}
+
+/* Bytes to step over after a line, including its newline if it ended on one */
+static size_t lcdLineAdvance(const char* text, size_t line_length, size_t remaining) {
+	if (line_length < LCD_COLS && line_length < remaining && text[line_length] == '\n') {
+		line_length++;
+	}
+	return line_length;
+}
+
+/* Show one line under a "Line N:" caption */
+static void lcdShowLine(const char* text, size_t line_length, int line_number) {
+	char line_buffer[LCD_COLS + 1];
+
+	memset(line_buffer, 0, sizeof(line_buffer));
+	memcpy(line_buffer, text, line_length);
+
+	HD44780_Clear();
+	HD44780_SetCursor(0,0);
+	HD44780_PrintStr("Line ");
+	char num[4];
+	snprintf(num, sizeof(num), "%d:", line_number);
+	HD44780_PrintStr(num);
+
+	HD44780_SetCursor(0,1);
+	HD44780_PrintStr(line_buffer);
+}
+
+/* Show the next line once its bytes are decrypted and the previous line has
+ * been up for SCROLL_DELAY. Never blocks, so reception carries on between calls. */
+void lcdStreamPoll(LcdStream* stream, size_t available, size_t total) {
+	if (stream->offset >= available) {
+		return;
+	}
+	if (stream->line_count > 0 && HAL_GetTick() - stream->last_shown < SCROLL_DELAY) {
+		return;
+	}
+
+	const char* line = stream->text + stream->offset;
+	size_t line_length = lcdLineLength(line, available - stream->offset);
+	// Complete once it is full width, ends at a newline, or ends the message
+	if (line_length < LCD_COLS && stream->offset + line_length < total &&
+			stream->offset + line_length >= available) {
+		return;
+	}
+
+	lcdShowLine(line, line_length, ++stream->line_count);
+	stream->last_shown = HAL_GetTick();
+	if (stream->line_count == 1) {
+		printf("Time to first line: %lu ms\r\n", (unsigned long)(stream->last_shown - stream->frame_start));
+	}
+	stream->offset += lcdLineAdvance(line, line_length, total - stream->offset);
+}
+
+/* Replace whatever is on the LCD after a failed frame. With streaming the
+ * screen may already hold lines of a message that was never verified. */
+void lcdShowError(const char* reason) {
+	HD44780_Clear();
+	HD44780_SetCursor(0,0);
+	HD44780_PrintStr("Message failed");
+	HD44780_SetCursor(0,1);
+	HD44780_PrintStr(reason);
+}
+
 /* Add this new function for LCD display */
 void displayTextOnLCD(const char* text, size_t length) {
-	char line_buffer[LCD_COLS + 1];
-	char *text_ptr = (char*)text;
+	const char *text_ptr = text;
 	size_t chars_processed = 0;
 	int line_count = 0;
 
@@ -315,40 +570,18 @@ void displayTextOnLCD(const char* text, size_t length) {
 	HAL_Delay(1000);
 
 	while (chars_processed < length) {
-		size_t line_length = 0;
-		// Find the length of the next line
-		while (line_length < LCD_COLS &&
-				chars_processed + line_length < length &&
-				text_ptr[line_length] != '\n') {
-			line_length++;
+		// Find the length of the next line and display it
+		size_t line_length = lcdLineLength(text_ptr, length - chars_processed);
+		lcdShowLine(text_ptr, line_length, ++line_count);
+		if (line_count == 1) {
+			firstLineTick = HAL_GetTick();
 		}
 
-		// Copy the line to buffer and null terminate
-		memset(line_buffer, 0, sizeof(line_buffer));
-		memcpy(line_buffer, text_ptr, line_length);
-
-		// Display the line
-		HD44780_Clear();
-		HD44780_SetCursor(0,0);
-		HD44780_PrintStr("Line ");
-		char num[4];
-		snprintf(num, sizeof(num), "%d:", ++line_count);
-		HD44780_PrintStr(num);
-
-		HD44780_SetCursor(0,1);
-		HD44780_PrintStr(line_buffer);
-
 		// Wait before showing next line
 		HAL_Delay(SCROLL_DELAY);
 
-		// Move to next line
-		if (line_length < LCD_COLS) {
-			// If we ended due to newline, skip it
-			if (text_ptr[line_length] == '\n') {
-				line_length++;
-			}
-		}
-
+		// Move to next line, skipping the newline it ended on
+		line_length = lcdLineAdvance(text_ptr, line_length, length - chars_processed);
 		text_ptr += line_length;
 		chars_processed += line_length;
 	}
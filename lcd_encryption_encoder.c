@@ -21,6 +21,10 @@
 #define KEY_SIZE 16
 #define ACCESS_KEY_SIZE 8
 
+/* Stack monitor */
+#define STACK_PAINT 0xC5C5C5C5u   // Unused stack words hold this from boot
+#define STACK_CANARY 0x5AFEC0DEu  // Guard word at the heap top, the stack's real limit
+
 /* Private variables ---------------------------------------------------------*/
 I2C_HandleTypeDef hi2c1;
 UART_HandleTypeDef huart2;
@@ -101,7 +105,7 @@ void clearScreen(void) {
 
 void printLegend(void) {
     printf("\r\n=== Button Legend =============================\r\n");
-    printf("A - 0 | B - 1 | C - 2 | D - ENTER\r\n");
+    printf("A - 0 | B - 1 | C - 2 | D - ENTER (alone: stack use)\r\n");
     printf("=============================================\r\n");
 }
 
@@ -276,6 +280,79 @@ void printSelectedText(void) {
     encryptSelectedText();
 }
 
+/* Stack Monitor */
+/* The stack grows down towards the heap, and nothing stops it at the
+ * _Min_Stack_Size reservation - that only bounds how far _sbrk lets the heap
+ * grow. So the whole gap from the heap top to the stack is painted at boot,
+ * and the guard canary sits at the heap top, moving up when malloc extends
+ * the heap. The deepest point the stack has reached is the first word above
+ * the guard that no longer holds the pattern. */
+extern uint8_t _estack;           // Linker script: top of RAM
+extern uint32_t _Min_Stack_Size;  // Linker script: stack reservation, the heap's upper bound
+extern void* _sbrk(ptrdiff_t incr);  // sysmem.c: _sbrk(0) is the current heap top
+
+static uint32_t* stackGuard = NULL;
+
+/* First whole word above the heap */
+static uint32_t* heapTop(void) {
+    return (uint32_t*)(((uintptr_t)_sbrk(0) + 3u) & ~(uintptr_t)3u);
+}
+
+/* Words the heap has taken are its own now, so the guard moves up with it */
+static void stackGuardFollowHeap(void) {
+    uint32_t* top = heapTop();
+    if (top > stackGuard) {
+        stackGuard = top;
+        *stackGuard = STACK_CANARY;
+    }
+}
+
+/* Fill everything below the caller's frame, down to the heap top */
+__attribute__((noinline)) void stackPaint(void) {
+    uint32_t* p = heapTop();
+    uint32_t* sp = (uint32_t*)__get_MSP();
+
+    stackGuard = p;
+    *p++ = STACK_CANARY;
+    while (p < sp) {
+        *p++ = STACK_PAINT;
+    }
+}
+
+/* Peak stack use since boot, in bytes */
+uint32_t stackHighWater(void) {
+    stackGuardFollowHeap();
+    uint32_t* p = stackGuard + 1;
+
+    while (p < (uint32_t*)&_estack && *p == STACK_PAINT) {
+        p++;
+    }
+    return (uint32_t)&_estack - (uint32_t)p;
+}
+
+/* Past the reservation the stack still works, but _sbrk may hand the same
+ * RAM to malloc, so that is flagged too */
+void stackReport(void) {
+    uint32_t peak = stackHighWater();
+    uint32_t reserved = (uint32_t)&_Min_Stack_Size;
+
+    printf("Stack: peak %lu of %lu bytes above the heap (%lu reserved)\r\n",
+           (unsigned long)peak, (unsigned long)((uint32_t)&_estack - (uint32_t)stackGuard),
+           (unsigned long)reserved);
+    if (peak > reserved) {
+        printf("Warning: stack peak exceeds _Min_Stack_Size\r\n");
+    }
+}
+
+/* Stop before a stack that has run into the heap corrupts anything else */
+void stackCheckCanary(void) {
+    stackGuardFollowHeap();
+    if (*stackGuard != STACK_CANARY) {
+        printf("\r\nStack overflow - guard word at the heap top overwritten\r\n");
+        Error_Handler();
+    }
+}
+
 /**
   * @brief  The application entry point.
   * @retval int
@@ -283,6 +360,7 @@ void printSelectedText(void) {
 int main(void)
 {
     /* MCU Configuration--------------------------------------------------------*/
+    stackPaint();
     HAL_Init();
     SystemClock_Config();
     MX_GPIO_Init();
@@ -353,16 +431,22 @@ int main(void)
                             updateLCDStatus("End Index", "Enter Para #");
                         } else {
                             printSelectedText();
+                            stackReport();
                         }
                         inputReceived = 0;
                         break;
                 }
             }
+            else if (row == 3) {
+                // ENTER with nothing entered reports stack use
+                stackReport();
+            }
         }
         else if (row == -1) {
             buttonReleased = 1;
         }
 
+        stackCheckCanary();
         HAL_Delay(10);
     }
 }
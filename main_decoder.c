@@ -20,6 +20,12 @@
 #define UART_TIMEOUT 5000
 #define MAX_RETRIES 3
 
+/* Channel multiplexer - data and log share huart2 as tagged frames */
+#define MUX_SOF 0x7E
+#define MUX_CHANNEL_DATA 0x01
+#define MUX_CHANNEL_LOG 0x02
+#define MUX_MAX_PAYLOAD 255
+
 /* Private variables ---------------------------------------------------------*/
 UART_HandleTypeDef huart2;
 
@@ -28,8 +34,7 @@ typedef struct {
     uint8_t key[KEY_SIZE];
     uint8_t access_key[ACCESS_KEY_SIZE + 1];
     size_t data_size;
-    uint8_t *encrypted_data;
-    uint8_t *decrypted_data;
+    uint8_t data[MAX_DATA_SIZE + 1];  // Received ciphertext, decrypted in place; +1 for the terminator
     uint32_t timestamp;
 } DecryptionInfo;
 
@@ -41,12 +46,149 @@ void MX_GPIO_Init(void);
 void MX_USART2_UART_Init(void);
 void Error_Handler(void);
 
-/* UART write override */
+/* Multiplexer function prototypes */
+void muxSendFrame(uint8_t channel, const uint8_t* payload, size_t length);
+HAL_StatusTypeDef muxReadFrame(uint32_t timeout);
+HAL_StatusTypeDef muxReceive(uint8_t* buffer, size_t size, uint32_t timeout);
+
+/* Multiplexer receive state - the data frame currently being consumed */
+static uint8_t muxRxPayload[MUX_MAX_PAYLOAD];
+static size_t muxRxLength = 0;
+static size_t muxRxPos = 0;
+static uint32_t muxRxBadFrames = 0;
+
+/* Bytes already taken off huart2 after a bad frame's SOF, still to be
+ * scanned for the next one */
+static uint8_t muxRxBacklog[MUX_MAX_PAYLOAD + 3];
+static size_t muxRxBacklogLen = 0;
+static size_t muxRxBacklogPos = 0;
+
+/* Frame: SOF, channel, length, payload, XOR checksum over channel/length/payload */
+void muxSendFrame(uint8_t channel, const uint8_t* payload, size_t length) {
+    uint8_t header[3] = {MUX_SOF, channel, (uint8_t)length};
+    uint8_t checksum = channel ^ (uint8_t)length;
+
+    for (size_t i = 0; i < length; i++) {
+        checksum ^= payload[i];
+    }
+
+    HAL_UART_Transmit(&huart2, header, sizeof(header), HAL_MAX_DELAY);
+    HAL_UART_Transmit(&huart2, (uint8_t*)payload, length, HAL_MAX_DELAY);
+    HAL_UART_Transmit(&huart2, &checksum, 1, HAL_MAX_DELAY);
+}
+
+/* UART write override - printf goes out on the log channel */
 int _write(int file, char *ptr, int len) {
-    HAL_UART_Transmit(&huart2, (uint8_t *)ptr, len, HAL_MAX_DELAY);
+    int sent = 0;
+    while (sent < len) {
+        int frameLen = (len - sent > MUX_MAX_PAYLOAD) ? MUX_MAX_PAYLOAD : len - sent;
+        muxSendFrame(MUX_CHANNEL_LOG, (uint8_t*)&ptr[sent], frameLen);
+        sent += frameLen;
+    }
     return len;
 }
 
+/* Next byte to scan: bytes put back after a bad frame come first */
+static HAL_StatusTypeDef muxReadByte(uint8_t* byte) {
+    if (muxRxBacklogPos < muxRxBacklogLen) {
+        *byte = muxRxBacklog[muxRxBacklogPos++];
+        return HAL_OK;
+    }
+    return HAL_UART_Receive(&huart2, byte, 1, 100);
+}
+
+/* Put bytes back in front of whatever is still waiting in the backlog. The
+ * frame came either from the backlog (freeing at least as much room as it
+ * puts back) or from the UART once the backlog was empty, so it always fits. */
+static void muxUnread(const uint8_t* bytes, size_t count) {
+    size_t waiting = muxRxBacklogLen - muxRxBacklogPos;
+    memmove(&muxRxBacklog[count], &muxRxBacklog[muxRxBacklogPos], waiting);
+    memcpy(muxRxBacklog, bytes, count);
+    muxRxBacklogPos = 0;
+    muxRxBacklogLen = count + waiting;
+}
+
+/* Read frames until a valid data frame is loaded. Log frames from the
+ * far end are skipped here; the host-side demultiplexer picks them up.
+ * A bad header or checksum costs only its SOF: scanning resumes at the
+ * byte after it, so a real frame start inside the bad one is still found.
+ * A data frame that fails its checksum returns HAL_ERROR - its bytes are
+ * gone, so the caller's stream is short. */
+HAL_StatusTypeDef muxReadFrame(uint32_t timeout) {
+    uint32_t startTick = HAL_GetTick();
+    uint8_t frame[MUX_MAX_PAYLOAD + 3];  // Channel, length, payload, checksum
+
+    while (HAL_GetTick() - startTick < timeout) {
+        uint8_t sof;
+        if (muxReadByte(&sof) != HAL_OK || sof != MUX_SOF) {
+            continue;
+        }
+
+        size_t got = 0;
+        size_t need = 2;
+        while (got < need && muxReadByte(&frame[got]) == HAL_OK) {
+            got++;
+            if (got == 1 && frame[0] != MUX_CHANNEL_DATA && frame[0] != MUX_CHANNEL_LOG) {
+                break;  // Bad header - not a frame start
+            }
+            if (got == 2) {
+                need = 3 + frame[1];
+            }
+        }
+
+        if (got == need) {
+            uint8_t expected = 0;
+            for (size_t i = 0; i < need - 1; i++) {
+                expected ^= frame[i];
+            }
+            if (expected == frame[need - 1]) {
+                if (frame[0] == MUX_CHANNEL_DATA) {
+                    memcpy(muxRxPayload, &frame[2], frame[1]);
+                    muxRxLength = frame[1];
+                    muxRxPos = 0;
+                    return HAL_OK;
+                }
+                continue;
+            }
+        }
+
+        muxRxBadFrames++;
+        muxUnread(frame, got);
+        if (got == need && frame[0] == MUX_CHANNEL_DATA) {
+            return HAL_ERROR;
+        }
+    }
+    return HAL_TIMEOUT;
+}
+
+/* Fill buffer with size bytes from the data channel */
+HAL_StatusTypeDef muxReceive(uint8_t* buffer, size_t size, uint32_t timeout) {
+    uint32_t startTick = HAL_GetTick();
+    size_t copied = 0;
+
+    while (copied < size) {
+        if (muxRxPos == muxRxLength) {
+            uint32_t elapsed = HAL_GetTick() - startTick;
+            if (elapsed >= timeout) {
+                return HAL_TIMEOUT;
+            }
+            HAL_StatusTypeDef status = muxReadFrame(timeout - elapsed);
+            if (status != HAL_OK) {
+                return status;  // HAL_ERROR: a data frame was corrupted
+            }
+        }
+
+        size_t count = muxRxLength - muxRxPos;
+        if (count > size - copied) {
+            count = size - copied;
+        }
+        memcpy(&buffer[copied], &muxRxPayload[muxRxPos], count);
+        muxRxPos += count;
+        copied += count;
+    }
+    return HAL_OK;
+}
+
 /* Clear screen helper */
 void clearScreen() {
     printf("\033[2J\033[H");
@@ -74,17 +216,9 @@ void decryptData(uint8_t* data, size_t length) {
     }
 }
 
-/* Improved UART reception with retry mechanism */
+/* UART reception from the multiplexed data channel */
 HAL_StatusTypeDef receiveWithTimeout(uint8_t* buffer, size_t size, uint32_t timeout) {
-    uint32_t startTick = HAL_GetTick();
-
-    while (HAL_GetTick() - startTick < timeout) {
-        if (HAL_UART_Receive(&huart2, buffer, size, 100) == HAL_OK) {
-            return HAL_OK;
-        }
-        HAL_Delay(10);
-    }
-    return HAL_TIMEOUT;
+    return muxReceive(buffer, size, timeout);
 }
 
 HAL_StatusTypeDef receiveEncryptedData() {
@@ -95,12 +229,6 @@ HAL_StatusTypeDef receiveEncryptedData() {
         return HAL_ERROR;
     }
 
-    // Clean previous data if any
-    if (decInfo.encrypted_data != NULL) {
-        free(decInfo.encrypted_data);
-        decInfo.encrypted_data = NULL;
-    }
-
     // Receive access key
     if (receiveWithTimeout(decInfo.access_key, ACCESS_KEY_SIZE + 1, UART_TIMEOUT) != HAL_OK) {
         printf("Error: Failed to receive access key\r\n");
@@ -125,13 +253,6 @@ HAL_StatusTypeDef receiveEncryptedData() {
         return HAL_ERROR;
     }
 
-    // Allocate memory for data
-    decInfo.encrypted_data = malloc(decInfo.data_size);
-    if (!decInfo.encrypted_data) {
-        printf("Error: Memory allocation failed\r\n");
-        return HAL_ERROR;
-    }
-
     // Receive data in chunks
     size_t bytesReceived = 0;
     size_t chunkSize = 32;
@@ -140,10 +261,9 @@ HAL_StatusTypeDef receiveEncryptedData() {
         size_t remainingBytes = decInfo.data_size - bytesReceived;
         size_t currentChunk = (remainingBytes < chunkSize) ? remainingBytes : chunkSize;
 
-        if (receiveWithTimeout(&decInfo.encrypted_data[bytesReceived],
+        if (receiveWithTimeout(&decInfo.data[bytesReceived],
                              currentChunk, UART_TIMEOUT) != HAL_OK) {
             printf("Error: Failed to receive data chunk at %d\r\n", (int)bytesReceived);
-            free(decInfo.encrypted_data);
             return HAL_ERROR;
         }
 
@@ -155,7 +275,6 @@ HAL_StatusTypeDef receiveEncryptedData() {
     if (receiveWithTimeout(&endMarker, 1, UART_TIMEOUT) != HAL_OK ||
         endMarker != 0x55) {
         printf("Error: Failed to receive end marker\r\n");
-        free(decInfo.encrypted_data);
         return HAL_ERROR;
     }
 
@@ -183,31 +302,18 @@ int main(void) {
             printf("Access Key: %s\r\n", decInfo.access_key);
             printf("Data Size: %d bytes\r\n", (int)decInfo.data_size);
 
-            // Allocate memory for decrypted data
-            decInfo.decrypted_data = malloc(decInfo.data_size + 1);  // +1 for null terminator
-            if (decInfo.decrypted_data) {
-                // Copy encrypted data
-                memcpy(decInfo.decrypted_data, decInfo.encrypted_data, decInfo.data_size);
-                decInfo.decrypted_data[decInfo.data_size] = '\0';  // Ensure null termination
-
-                // Derive key and decrypt
-                deriveKeyFromAccessKey();
-                decryptData(decInfo.decrypted_data, decInfo.data_size);
-
-                // Print decrypted text
-                printf("\r\n=== Decrypted Text ===========================\r\n");
-                printf("%s", (char*)decInfo.decrypted_data);
-                printf("\r\n=============================================\r\n");
-
-                // Clean up
-                free(decInfo.decrypted_data);
-                free(decInfo.encrypted_data);
-                decInfo.encrypted_data = NULL;
-                decInfo.decrypted_data = NULL;
-
-                // Ready for next transmission
-                printf("\r\nWaiting for next transmission...\r\n");
-            }
+            // Derive key and decrypt in place
+            decInfo.data[decInfo.data_size] = '\0';  // Ensure null termination
+            deriveKeyFromAccessKey();
+            decryptData(decInfo.data, decInfo.data_size);
+
+            // Print decrypted text
+            printf("\r\n=== Decrypted Text ===========================\r\n");
+            printf("%s", (char*)decInfo.data);
+            printf("\r\n=============================================\r\n");
+
+            // Ready for next transmission
+            printf("\r\nWaiting for next transmission...\r\n");
         } else {
             HAL_Delay(100);  // Wait before retrying
         }
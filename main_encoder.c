@@ -19,6 +19,17 @@
 #define KEY_SIZE 16
 #define ACCESS_KEY_SIZE 8
 
+/* Stack monitor */
+#define STACK_PAINT 0xC5C5C5C5u   // Unused stack words hold this from boot
+#define STACK_CANARY 0x5AFEC0DEu  // Guard word at the heap top, the stack's real limit
+
+/* Channel multiplexer - data and log share huart2 as tagged frames */
+#define MUX_SOF 0x7E
+#define MUX_CHANNEL_DATA 0x01
+#define MUX_CHANNEL_LOG 0x02
+#define MUX_MAX_PAYLOAD 255
+#define MUX_LOG_QUEUE_SIZE 512
+
 /* Private variables ---------------------------------------------------------*/
 UART_HandleTypeDef huart2;
 
@@ -33,6 +44,12 @@ void generateAccessKey(void);
 void deriveKeyFromAccessKey(void);
 void encryptData(uint8_t* data, size_t length);
 void encryptSelectedText(void);
+void transmitEncryptedData(void);
+
+/* Multiplexer function prototypes */
+void muxSendFrame(uint8_t channel, const uint8_t* payload, size_t length);
+void muxSend(uint8_t channel, const uint8_t* data, size_t length);
+void muxFlushLog(size_t maxBytes);
 
 /* Encryption structures and variables */
 typedef struct {
@@ -81,9 +98,69 @@ TextPosition endPos = {0, 0, 0};
 InputState currentState = INPUT_PARAGRAPH;
 TextPosition* currentPos = &startPos;
 
-/* Override _write to enable printf over UART */
+/* Multiplexer state - log output is queued while the data channel is busy */
+static uint8_t muxLogQueue[MUX_LOG_QUEUE_SIZE];
+static size_t muxLogCount = 0;
+static uint32_t muxLogDropped = 0;
+static uint8_t muxDataActive = 0;
+
+/* Frame: SOF, channel, length, payload, XOR checksum over channel/length/payload */
+void muxSendFrame(uint8_t channel, const uint8_t* payload, size_t length) {
+    uint8_t header[3] = {MUX_SOF, channel, (uint8_t)length};
+    uint8_t checksum = channel ^ (uint8_t)length;
+
+    for (size_t i = 0; i < length; i++) {
+        checksum ^= payload[i];
+    }
+
+    HAL_UART_Transmit(&huart2, header, sizeof(header), HAL_MAX_DELAY);
+    HAL_UART_Transmit(&huart2, (uint8_t*)payload, length, HAL_MAX_DELAY);
+    HAL_UART_Transmit(&huart2, &checksum, 1, HAL_MAX_DELAY);
+}
+
+void muxSend(uint8_t channel, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        size_t frameLen = (length > MUX_MAX_PAYLOAD) ? MUX_MAX_PAYLOAD : length;
+        muxSendFrame(channel, data, frameLen);
+        data += frameLen;
+        length -= frameLen;
+    }
+}
+
+/* Send up to maxBytes of queued log output, data frames always go first */
+void muxFlushLog(size_t maxBytes) {
+    size_t count = (muxLogCount < maxBytes) ? muxLogCount : maxBytes;
+
+    if (count == 0) {
+        return;
+    }
+
+    muxSend(MUX_CHANNEL_LOG, muxLogQueue, count);
+    memmove(muxLogQueue, &muxLogQueue[count], muxLogCount - count);
+    muxLogCount -= count;
+}
+
+/* Override _write to route printf through the log channel. Outside a data
+ * frame the queue is flushed as it fills, so nothing is lost; during one,
+ * whatever does not fit is dropped and counted. */
 int _write(int file, char *ptr, int len) {
-    HAL_UART_Transmit(&huart2, (uint8_t *)ptr, len, HAL_MAX_DELAY);
+    size_t remaining = (size_t)len;
+
+    while (remaining > 0) {
+        size_t space = MUX_LOG_QUEUE_SIZE - muxLogCount;
+        size_t count = (remaining < space) ? remaining : space;
+
+        memcpy(&muxLogQueue[muxLogCount], ptr, count);
+        muxLogCount += count;
+        ptr += count;
+        remaining -= count;
+
+        if (muxDataActive) {
+            break;
+        }
+        muxFlushLog(MUX_LOG_QUEUE_SIZE);
+    }
+    muxLogDropped += remaining;
     return len;
 }
 
@@ -95,7 +172,7 @@ void clearScreen() {
 /* Print legend */
 void printLegend() {
     printf("\r\n=== Button Legend =============================\r\n");
-    printf("A - 0 | B - 1 | C - 2 | D - ENTER\r\n");
+    printf("A - 0 | B - 1 | C - 2 | D - ENTER (alone: stack use)\r\n");
     printf("=============================================\r\n");
 }
 
@@ -207,36 +284,47 @@ void encryptSelectedText() {
 
 /* Add new transmission function */
 void transmitEncryptedData() {
-	// Send start marker with delay
-	    uint8_t startMarker = 0xAA;
-	    HAL_UART_Transmit(&huart2, &startMarker, 1, HAL_MAX_DELAY);
-	    HAL_Delay(10);
-
-	    // Send access key
-	    HAL_UART_Transmit(&huart2, encInfo.access_key, ACCESS_KEY_SIZE + 1, HAL_MAX_DELAY);
-	    HAL_Delay(10);
-
-	    // Send timestamp
-	    HAL_UART_Transmit(&huart2, (uint8_t*)&encInfo.timestamp, 4, HAL_MAX_DELAY);
-	    HAL_Delay(10);
-
-	    // Send data size
-	    HAL_UART_Transmit(&huart2, (uint8_t*)&encInfo.data_size, 4, HAL_MAX_DELAY);
-	    HAL_Delay(10);
-
-	    // Send encrypted data in chunks
-	    size_t chunkSize = 32;
-	    for(size_t i = 0; i < encInfo.data_size; i += chunkSize) {
-	        size_t currentChunk = ((encInfo.data_size - i) < chunkSize) ?
-	                              (encInfo.data_size - i) : chunkSize;
-	        HAL_UART_Transmit(&huart2, &encInfo.encrypted_data[i], currentChunk, HAL_MAX_DELAY);
-	        HAL_Delay(5);
-	    }
+    uint8_t startMarker = 0xAA;
+    uint8_t endMarker = 0x55;
+
+    muxDataActive = 1;
+
+    // Send start marker with delay
+    muxSend(MUX_CHANNEL_DATA, &startMarker, 1);
+    HAL_Delay(10);
+
+    // Send access key
+    muxSend(MUX_CHANNEL_DATA, encInfo.access_key, ACCESS_KEY_SIZE + 1);
+    HAL_Delay(10);
+
+    // Send timestamp
+    muxSend(MUX_CHANNEL_DATA, (uint8_t*)&encInfo.timestamp, 4);
+    HAL_Delay(10);
+
+    // Send data size
+    muxSend(MUX_CHANNEL_DATA, (uint8_t*)&encInfo.data_size, 4);
+    HAL_Delay(10);
+
+    // Send encrypted data in chunks, letting a little log output through between them
+    size_t chunkSize = 32;
+    for(size_t i = 0; i < encInfo.data_size; i += chunkSize) {
+        size_t currentChunk = ((encInfo.data_size - i) < chunkSize) ?
+                              (encInfo.data_size - i) : chunkSize;
+        muxSend(MUX_CHANNEL_DATA, &encInfo.encrypted_data[i], currentChunk);
+        muxFlushLog(chunkSize);
+        HAL_Delay(5);
+    }
+
+    // Send end marker
+    muxSend(MUX_CHANNEL_DATA, &endMarker, 1);
+    HAL_Delay(10);
 
-	    // Send end marker
-	    uint8_t endMarker = 0x55;
-	    HAL_UART_Transmit(&huart2, &endMarker, 1, HAL_MAX_DELAY);
-	    HAL_Delay(10);
+    muxDataActive = 0;
+    muxFlushLog(MUX_LOG_QUEUE_SIZE);
+    if (muxLogDropped > 0) {
+        printf("Log channel dropped %lu bytes during transmit\r\n", (unsigned long)muxLogDropped);
+        muxLogDropped = 0;
+    }
 }
 
 void printSelectedText() {
@@ -281,11 +369,85 @@ void updateInput(const char* promptType, int value) {
     printf("\r%d", value);
 }
 
+/* Stack Monitor */
+/* The stack grows down towards the heap, and nothing stops it at the
+ * _Min_Stack_Size reservation - that only bounds how far _sbrk lets the heap
+ * grow. So the whole gap from the heap top to the stack is painted at boot,
+ * and the guard canary sits at the heap top, moving up when malloc extends
+ * the heap. The deepest point the stack has reached is the first word above
+ * the guard that no longer holds the pattern. */
+extern uint8_t _estack;           // Linker script: top of RAM
+extern uint32_t _Min_Stack_Size;  // Linker script: stack reservation, the heap's upper bound
+extern void* _sbrk(ptrdiff_t incr);  // sysmem.c: _sbrk(0) is the current heap top
+
+static uint32_t* stackGuard = NULL;
+
+/* First whole word above the heap */
+static uint32_t* heapTop(void) {
+    return (uint32_t*)(((uintptr_t)_sbrk(0) + 3u) & ~(uintptr_t)3u);
+}
+
+/* Words the heap has taken are its own now, so the guard moves up with it */
+static void stackGuardFollowHeap(void) {
+    uint32_t* top = heapTop();
+    if (top > stackGuard) {
+        stackGuard = top;
+        *stackGuard = STACK_CANARY;
+    }
+}
+
+/* Fill everything below the caller's frame, down to the heap top */
+__attribute__((noinline)) void stackPaint(void) {
+    uint32_t* p = heapTop();
+    uint32_t* sp = (uint32_t*)__get_MSP();
+
+    stackGuard = p;
+    *p++ = STACK_CANARY;
+    while (p < sp) {
+        *p++ = STACK_PAINT;
+    }
+}
+
+/* Peak stack use since boot, in bytes */
+uint32_t stackHighWater(void) {
+    stackGuardFollowHeap();
+    uint32_t* p = stackGuard + 1;
+
+    while (p < (uint32_t*)&_estack && *p == STACK_PAINT) {
+        p++;
+    }
+    return (uint32_t)&_estack - (uint32_t)p;
+}
+
+/* Past the reservation the stack still works, but _sbrk may hand the same
+ * RAM to malloc, so that is flagged too */
+void stackReport(void) {
+    uint32_t peak = stackHighWater();
+    uint32_t reserved = (uint32_t)&_Min_Stack_Size;
+
+    printf("Stack: peak %lu of %lu bytes above the heap (%lu reserved)\r\n",
+           (unsigned long)peak, (unsigned long)((uint32_t)&_estack - (uint32_t)stackGuard),
+           (unsigned long)reserved);
+    if (peak > reserved) {
+        printf("Warning: stack peak exceeds _Min_Stack_Size\r\n");
+    }
+}
+
+/* Stop before a stack that has run into the heap corrupts anything else */
+void stackCheckCanary(void) {
+    stackGuardFollowHeap();
+    if (*stackGuard != STACK_CANARY) {
+        printf("\r\nStack overflow - guard word at the heap top overwritten\r\n");
+        Error_Handler();
+    }
+}
+
 /**
   * @brief  The application entry point.
   * @retval int
   */
 int main(void) {
+    stackPaint();
     HAL_Init();
     SystemClock_Config();
     MX_GPIO_Init();
@@ -340,16 +502,22 @@ int main(void) {
                             printPrompt("\nEND INDEX", "ENTER PARAGRAPH #");
                         } else {
                             printSelectedText();  // This will now also handle encryption
+                            stackReport();
                         }
                         inputReceived = 0;
                         break;
                 }
             }
+            else if (row == 3) {
+                // ENTER with nothing entered reports stack use
+                stackReport();
+            }
         }
         else if (row == -1) {
             buttonReleased = 1;
         }
 
+        stackCheckCanary();
         HAL_Delay(10);
     }
 }
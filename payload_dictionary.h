@@ -0,0 +1,88 @@
+/* Payload dictionary - generated by tools/train_dictionary.py from content/, do not edit.
+ * Built into both encoder and decoder; see the tool for the format.
+ * Trained on all of content/, so the in-sample ratio flatters it: paragraphs go
+ * to 26% of their padded size in-sample, 85% held out (each paragraph against
+ * a dictionary trained on the others). */
+#ifndef PAYLOAD_DICTIONARY_H
+#define PAYLOAD_DICTIONARY_H
+
+#include <stdint.h>
+
+#define PAYLOAD_DICT_SIZE 237
+#define PAYLOAD_DICT_CRC 0x336E124EUL
+#define PAYLOAD_DICT_HASH_BITS 8
+#define PAYLOAD_DICT_NONE 0xFFFF
+
+/* Hash of the four bytes at p, the key of the chains below */
+#define PAYLOAD_DICT_HASH(p) ((uint32_t)(((uint32_t)(p)[0] | (uint32_t)(p)[1] << 8 | \
+		(uint32_t)(p)[2] << 16 | (uint32_t)(p)[3] << 24) * 2654435761u) >> (32 - PAYLOAD_DICT_HASH_BITS))
+
+static const uint8_t PAYLOAD_DICT[237] = {
+	0x57, 0x68, 0x61, 0x74, 0x20, 0x69, 0x73, 0x20, 0x74, 0x68, 0x65, 0x20, 0x64, 0x65, 0x72, 0x69,
+	0x76, 0x61, 0x74, 0x69, 0x76, 0x65, 0x20, 0x6F, 0x66, 0x20, 0x32, 0x78, 0x5E, 0x33, 0x20, 0x2B,
+	0x20, 0x33, 0x78, 0x3F, 0x0A, 0x54, 0x68, 0x65, 0x20, 0x64, 0x65, 0x72, 0x69, 0x76, 0x61, 0x74,
+	0x69, 0x76, 0x65, 0x20, 0x69, 0x73, 0x20, 0x36, 0x78, 0x5E, 0x32, 0x20, 0x2B, 0x20, 0x33, 0x2E,
+	0x0A, 0x65, 0x20, 0x6D, 0x6F, 0x6D, 0x65, 0x6E, 0x74, 0x20, 0x6F, 0x66, 0x20, 0x69, 0x6E, 0x65,
+	0x72, 0x74, 0x69, 0x61, 0x20, 0x6F, 0x66, 0x20, 0x61, 0x20, 0x72, 0x6F, 0x6C, 0x6C, 0x69, 0x6E,
+	0x67, 0x20, 0x64, 0x69, 0x73, 0x6B, 0x3F, 0x0A, 0x49, 0x20, 0x3D, 0x20, 0x31, 0x2F, 0x32, 0x4D,
+	0x52, 0x5E, 0x32, 0x2E, 0x0A, 0x57, 0x68, 0x65, 0x6E, 0x20, 0x74, 0x68, 0x65, 0x20, 0x64, 0x65,
+	0x74, 0x65, 0x72, 0x6D, 0x69, 0x6E, 0x61, 0x6E, 0x74, 0x20, 0x64, 0x6F, 0x65, 0x73, 0x20, 0x6E,
+	0x6F, 0x74, 0x20, 0x65, 0x71, 0x75, 0x61, 0x6C, 0x20, 0x74, 0x6F, 0x20, 0x30, 0x2C, 0x20, 0x69,
+	0x73, 0x20, 0x74, 0x68, 0x65, 0x20, 0x6D, 0x61, 0x74, 0x72, 0x69, 0x78, 0x20, 0x69, 0x6E, 0x76,
+	0x65, 0x72, 0x74, 0x69, 0x62, 0x6C, 0x65, 0x3F, 0x0A, 0x54, 0x68, 0x65, 0x20, 0x6D, 0x61, 0x74,
+	0x72, 0x69, 0x78, 0x20, 0x69, 0x73, 0x20, 0x69, 0x6E, 0x64, 0x65, 0x65, 0x64, 0x20, 0x69, 0x6E,
+	0x76, 0x65, 0x72, 0x74, 0x69, 0x62, 0x6C, 0x65, 0x20, 0x69, 0x66, 0x20, 0x74, 0x68, 0x65, 0x20,
+	0x64, 0x65, 0x74, 0x28, 0x41, 0x29, 0x20, 0x21, 0x3D, 0x20, 0x30, 0x2E, 0x0A,
+};
+
+/* Match search index for the encoder - define PAYLOAD_DICT_INDEX to get it */
+#ifdef PAYLOAD_DICT_INDEX
+static const uint16_t PAYLOAD_DICT_HEAD[256] = {
+	0xFFFF, 0x005D, 0x009C, 0x00E7, 0x001D, 0x00DA, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x008D,
+	0x00E6, 0x0086, 0x00A0, 0xFFFF, 0x00AB, 0xFFFF, 0x003E, 0xFFFF, 0x0047, 0x00E4, 0x0069, 0xFFFF,
+	0xFFFF, 0x00C7, 0xFFFF, 0x00D5, 0xFFFF, 0xFFFF, 0x005C, 0x0064, 0xFFFF, 0x0080, 0x00E5, 0xFFFF,
+	0x00D8, 0x0099, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0053, 0x0068, 0xFFFF, 0x00DB, 0xFFFF,
+	0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0062, 0x00D0, 0xFFFF, 0xFFFF, 0x009B, 0xFFFF, 0x009F, 0xFFFF,
+	0x00BB, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x00E8, 0xFFFF, 0x00D2, 0xFFFF, 0xFFFF, 0x00BF, 0x008B,
+	0xFFFF, 0x0044, 0xFFFF, 0xFFFF, 0xFFFF, 0x00D4, 0x006B, 0xFFFF, 0xFFFF, 0xFFFF, 0x00C3, 0xFFFF,
+	0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x00BD, 0xFFFF, 0xFFFF, 0xFFFF, 0x0034, 0x00DC, 0x002F, 0x0075,
+	0x00C0, 0x008A, 0x00CF, 0x007F, 0xFFFF, 0xFFFF, 0x003A, 0x00CD, 0xFFFF, 0x00D9, 0xFFFF, 0x00E3,
+	0x006A, 0x0038, 0x0020, 0xFFFF, 0xFFFF, 0x00D6, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+	0xFFFF, 0x0087, 0x0029, 0xFFFF, 0x00E0, 0xFFFF, 0x00B5, 0x00C8, 0xFFFF, 0xFFFF, 0xFFFF, 0x00E1,
+	0xFFFF, 0x00C2, 0x0046, 0xFFFF, 0xFFFF, 0x0081, 0x00B4, 0xFFFF, 0xFFFF, 0x009D, 0x003C, 0x006E,
+	0xFFFF, 0x0097, 0x0050, 0x0076, 0x008E, 0x002E, 0x00B9, 0x0093, 0xFFFF, 0x0030, 0xFFFF, 0x00E2,
+	0x006F, 0xFFFF, 0x0000, 0x00C4, 0xFFFF, 0x0037, 0xFFFF, 0xFFFF, 0x0040, 0x0035, 0x004C, 0x00CE,
+	0xFFFF, 0x00DF, 0xFFFF, 0xFFFF, 0x0077, 0xFFFF, 0x0051, 0x002D, 0xFFFF, 0xFFFF, 0xFFFF, 0x00D3,
+	0x00CC, 0x00BC, 0xFFFF, 0xFFFF, 0x001F, 0x00DE, 0xFFFF, 0x003F, 0x00BA, 0xFFFF, 0x0045, 0xFFFF,
+	0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0096, 0x0014, 0x009A, 0x0032, 0x0090, 0xFFFF, 0x00D7, 0x0095,
+	0xFFFF, 0x0098, 0xFFFF, 0xFFFF, 0xFFFF, 0x005E, 0x0058, 0xFFFF, 0x0057, 0xFFFF, 0xFFFF, 0x00C9,
+	0xFFFF, 0x001A, 0xFFFF, 0x0073, 0xFFFF, 0x00D1, 0x0052, 0x00BE, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+	0xFFFF, 0x0084, 0x00CB, 0x00B6, 0x0088, 0xFFFF, 0x0059, 0xFFFF, 0xFFFF, 0x0066, 0xFFFF, 0xFFFF,
+	0x00B7, 0x005B, 0xFFFF, 0xFFFF, 0xFFFF, 0x00E9, 0xFFFF, 0x0078, 0x00CA, 0x00C5, 0xFFFF, 0x0055,
+	0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+};
+static const uint16_t PAYLOAD_DICT_NEXT[237] = {
+	0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+	0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x000E, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+	0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0019, 0xFFFF,
+	0xFFFF, 0xFFFF, 0x0009, 0x000A, 0x000B, 0x000C, 0x000D, 0x0012, 0x000F, 0x0010, 0x0011, 0x002B,
+	0x0013, 0x002A, 0xFFFF, 0x0004, 0xFFFF, 0x0022, 0x0026, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x001E,
+	0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0015, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0042, 0xFFFF,
+	0x0041, 0x0016, 0x0036, 0x0023, 0xFFFF, 0x0001, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+	0x0049, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0048, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0024,
+	0x0027, 0x0039, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0021, 0xFFFF, 0x001C, 0xFFFF, 0xFFFF,
+	0xFFFF, 0x0007, 0x004D, 0xFFFF, 0x0031, 0x0018, 0x002C, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+	0xFFFF, 0x006D, 0x0008, 0x004A, 0x0060, 0xFFFF, 0x007D, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x006C,
+	0x0002, 0xFFFF, 0xFFFF, 0x0083, 0xFFFF, 0x0082, 0xFFFF, 0x0028, 0x003D, 0x0089, 0xFFFF, 0x0074,
+	0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0x0091, 0x003B, 0xFFFF, 0xFFFF, 0x0072, 0xFFFF,
+	0x0065, 0xFFFF, 0x0033, 0x0005, 0x0006, 0x0079, 0x007A, 0xFFFF, 0x0063, 0x0071, 0xFFFF, 0x0061,
+	0x0092, 0xFFFF, 0xFFFF, 0x0043, 0xFFFF, 0x005F, 0x0067, 0x0056, 0x004F, 0x004E, 0xFFFF, 0x008F,
+	0xFFFF, 0xFFFF, 0xFFFF, 0x004B, 0x00AD, 0x0025, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7, 0x00A8,
+	0x00A9, 0x00AA, 0x005A, 0x009E, 0x0070, 0x0094, 0xFFFF, 0xFFFF, 0x0085, 0xFFFF, 0xFFFF, 0x001B,
+	0x00C1, 0x00AC, 0x00B8, 0x00AE, 0x00AF, 0x00B0, 0x00B1, 0x00B2, 0x00B3, 0xFFFF, 0x0054, 0xFFFF,
+	0xFFFF, 0xFFFF, 0xFFFF, 0x00A1, 0x00A2, 0x007B, 0x007C, 0x007E, 0x0017, 0x00DD, 0x008C, 0xFFFF,
+	0xFFFF, 0xFFFF, 0x0003, 0xFFFF, 0xFFFF, 0x00C6, 0xFFFF, 0xFFFF, 0xFFFF,
+};
+#endif
+
+#endif /* PAYLOAD_DICTIONARY_H */
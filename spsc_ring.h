@@ -0,0 +1,111 @@
+/* SPSC ring buffer - lock-free byte queue between one producer and one
+ * consumer, either of which may run in an interrupt. Used by FINAL_ENCODER.c
+ * for the debug log and built as-is into tools/spsc_stress.c.
+ *
+ * head is only written by the producer and tail only by the consumer; both
+ * run freely and are masked on access. They are published with release
+ * stores and read with acquire loads: on the Cortex-M4 GCC emits those as
+ * the plain access plus a DMB, and on the host -fsanitize=thread can follow
+ * them. A bad size goes to Error_Handler(), which the includer provides. */
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+	uint8_t* buffer;
+	uint32_t mask;              // Size - 1, size is a power of two
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	volatile uint32_t overflows; // Bytes refused because the ring was full
+	volatile uint32_t high_water;
+} SpscRing;
+
+#define SPSC_RING_STORAGE(name, size) \
+	static uint8_t name[size] __attribute__((aligned(32)))  // Cache line on M7 parts, word on the F4
+
+#define SPSC_LOAD_ACQUIRE(x) __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define SPSC_STORE_RELEASE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+
+void Error_Handler(void);
+
+static inline void ringInit(SpscRing* ring, uint8_t* storage, uint32_t size) {
+	if (size == 0 || (size & (size - 1)) != 0) {
+		Error_Handler();
+	}
+	ring->buffer = storage;
+	ring->mask = size - 1;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->overflows = 0;
+	ring->high_water = 0;
+}
+
+static inline uint32_t ringCount(const SpscRing* ring) {
+	return SPSC_LOAD_ACQUIRE(ring->head) - SPSC_LOAD_ACQUIRE(ring->tail);
+}
+
+/* Producer side - bytes that can be pushed without overflowing */
+static inline uint32_t ringSpace(const SpscRing* ring) {
+	return (ring->mask + 1) - (ring->head - SPSC_LOAD_ACQUIRE(ring->tail));
+}
+
+/* Producer side - copy in as much of data as fits, returns the bytes queued */
+static inline uint32_t ringPush(SpscRing* ring, const uint8_t* data, uint32_t length) {
+	uint32_t head = ring->head;
+	uint32_t space = (ring->mask + 1) - (head - SPSC_LOAD_ACQUIRE(ring->tail));
+	uint32_t count = (length < space) ? length : space;
+
+	uint32_t offset = head & ring->mask;
+	uint32_t first = (ring->mask + 1) - offset;
+	if (first > count) first = count;
+	memcpy(&ring->buffer[offset], data, first);
+	memcpy(ring->buffer, data + first, count - first);
+
+	SPSC_STORE_RELEASE(ring->head, head + count);  // Bytes land before the consumer can see the new head
+
+	ring->overflows += length - count;
+	uint32_t used = head + count - SPSC_LOAD_ACQUIRE(ring->tail);
+	if (used > ring->high_water) {
+		ring->high_water = used;
+	}
+	return count;
+}
+
+/* Consumer side - contiguous run at the tail, for handing straight to DMA */
+static inline uint32_t ringPeek(SpscRing* ring, uint8_t** data) {
+	uint32_t tail = ring->tail;
+	uint32_t count = SPSC_LOAD_ACQUIRE(ring->head) - tail;  // Read head before the bytes it covers
+	uint32_t offset = tail & ring->mask;
+
+	if (count > (ring->mask + 1) - offset) {
+		count = (ring->mask + 1) - offset;
+	}
+	*data = &ring->buffer[offset];
+	return count;
+}
+
+/* Consumer side - release bytes returned by ringPeek */
+static inline void ringAdvance(SpscRing* ring, uint32_t count) {
+	SPSC_STORE_RELEASE(ring->tail, ring->tail + count);  // Finish reading before the producer may reuse the space
+}
+
+/* Consumer side - copy out up to length bytes, returns the bytes taken */
+static inline uint32_t ringPop(SpscRing* ring, uint8_t* data, uint32_t length) {
+	uint32_t taken = 0;
+	while (taken < length) {
+		uint8_t* run;
+		uint32_t count = ringPeek(ring, &run);
+		if (count == 0) {
+			break;
+		}
+		if (count > length - taken) count = length - taken;
+		memcpy(data + taken, run, count);
+		ringAdvance(ring, count);
+		taken += count;
+	}
+	return taken;
+}
+
+#endif /* SPSC_RING_H */
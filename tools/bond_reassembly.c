@@ -0,0 +1,289 @@
+/**
+ ******************************************************************************
+ * @file           : bond_reassembly.c
+ * @brief          : Host test of the decoder's bonded-port reassembly
+ ******************************************************************************
+ * Runs receiveBonded and its receive callbacks from channel_bond.h, the
+ * code FINAL_DECODER.c builds, against simulated UARTs. The wire carries
+ * what transmitBonded in FINAL_ENCODER.c sends - chunk k, behind the header
+ * bondPackHeader writes, on port k % BOND_PORTS - and each port's DMA fills
+ * its armed buffer at its own random pace, so ports run ahead of and behind
+ * each other. Each payload is sent one of these ways:
+ *
+ *   clean       as the encoder sends it - must come back HAL_OK and equal
+ *   shuffled    two chunks swapped, on one port or across two
+ *   dropped     one chunk missing from its port
+ *   misrouted   one chunk sent on the wrong port
+ *   stalled     one port goes quiet part way through
+ *   error       one port reports a UART error part way through
+ *   slow        the main loop is held up after a chunk, so a port's two
+ *               buffers fill and its next chunk would be lost
+ *
+ * Every damaged payload must fail, and the reasons the decoder gave are
+ * tallied - a stalled, errored or overrun port must fail as a port failure.
+ * No payload may come back HAL_OK unless it matches what was sent byte for
+ * byte, and every prefix handed to decrypt-on-receive must already match.
+ * The RX ring path (huart1 chunks out of the receive ring) is not modelled.
+ *
+ *   cc -O2 -I. -o bond_reassembly tools/bond_reassembly.c
+ *   ./bond_reassembly [-n payloads] [-s seed]
+ *
+ * Build with -DBOND_PORTS=3 (or more) to check wider bonds.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Bonding - as FINAL_DECODER.c configures it */
+#ifndef BOND_PORTS
+#define BOND_PORTS 2
+#endif
+#define BOND_CHUNK_SIZE 64
+#define BOND_HEADER_SIZE 3        // Sequence number (LE16) + chunk length
+#define BOND_RX_TIMEOUT 1000      // ms without a chunk before a port is declared failed
+#define MAX_DATA_SIZE 10240
+
+typedef enum { HAL_OK, HAL_ERROR } HAL_StatusTypeDef;
+
+/* Simulated UART: the bytes on the wire and the buffer its DMA is filling */
+typedef struct {
+	uint8_t wire[2 * MAX_DATA_SIZE];
+	uint32_t wire_len;
+	uint32_t wire_pos;
+	uint8_t* dma;
+	uint16_t dma_len;
+	uint16_t dma_pos;
+	uint32_t stall_at;   // Wire position the port goes quiet at
+	uint32_t error_at;   // Wire position the port reports an error at
+	int pace;            // Percent chance a byte arrives per tick
+} UART_HandleTypeDef;
+
+static UART_HandleTypeDef huart1, huart6, huart3, huart4;
+static uint32_t tick = 0;
+
+static uint32_t HAL_GetTick(void);
+static void HAL_UART_Receive_DMA(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size) {
+	huart->dma = data;
+	huart->dma_len = size;
+	huart->dma_pos = 0;
+}
+
+static void HAL_UART_AbortReceive(UART_HandleTypeDef* huart) {
+	huart->dma = NULL;
+}
+
+static char lastError[80];
+#define printf(...) snprintf(lastError, sizeof(lastError), __VA_ARGS__)
+
+static uint8_t sent[MAX_DATA_SIZE];
+static uint8_t received[MAX_DATA_SIZE];
+static uint32_t prefixEnd = 0;    // Longest prefix reported so far
+static bool prefixEarly = false; // A reported prefix had not fully arrived
+
+/* Decrypt-on-receive: the bytes below end must be final */
+static void checkPrefix(uint32_t end) {
+	if(end < prefixEnd || memcmp(received, sent, end) != 0) {
+		prefixEarly = true;
+	}
+	prefixEnd = end;
+}
+
+/* Reassembly - the decoder's own */
+#define BOND_RECEIVE 1
+#define BOND_RX_PREFIX(end) checkPrefix(end)
+
+static UART_HandleTypeDef* const bondPorts[] = {&huart1, &huart6, &huart3, &huart4};
+
+#include "channel_bond.h"
+#undef printf
+
+/* Simulation */
+typedef enum { CLEAN, SHUFFLED, DROPPED, MISROUTED, STALLED, PORT_ERROR, SLOW, CASES } Case;
+
+static const char* const caseNames[CASES] = {
+	"clean", "shuffled", "dropped", "misrouted", "stalled", "error", "slow"
+};
+
+#define SLOW_TICKS 900  // Main loop held up for - inside BOND_RX_TIMEOUT
+
+static int slowPort = -1;
+static uint16_t slowAfter = 0;
+
+/* Every port's DMA moves on by one tick */
+static void advance(void) {
+	tick++;
+	for(int i = 0; i < BOND_PORTS; i++) {
+		UART_HandleTypeDef* huart = bondPorts[i];
+		for(int b = 0; b < 4; b++) {
+			if(huart->wire_pos >= huart->wire_len || huart->wire_pos >= huart->stall_at ||
+					huart->dma == NULL || rand() % 100 >= huart->pace) {
+				break;
+			}
+			if(huart->wire_pos == huart->error_at) {
+				// HAL stops the DMA on a framing or overrun error
+				huart->error_at = UINT32_MAX;
+				huart->dma = NULL;
+				bondRxError(huart);
+				break;
+			}
+			huart->dma[huart->dma_pos++] = huart->wire[huart->wire_pos++];
+			if(huart->dma_pos == huart->dma_len) {
+				huart->dma = NULL;
+				bondRxComplete(huart);
+			}
+		}
+	}
+}
+
+/* Each call is a tick. Once the slow port has taken its chunk the main loop is
+ * held up inside this call while the ports keep receiving. */
+static uint32_t HAL_GetTick(void) {
+	advance();
+	if(slowPort >= 0 && bondRx[slowPort].next_seq > slowAfter) {
+		slowPort = -1;
+		for(int t = 0; t < SLOW_TICKS; t++) {
+			advance();
+		}
+	}
+	return tick;
+}
+
+typedef struct {
+	uint32_t offset;  // Where the chunk's frame starts on its port's wire
+	uint16_t length;
+	int port;
+} WireChunk;
+
+static WireChunk chunks[MAX_DATA_SIZE / BOND_CHUNK_SIZE];
+
+/* As transmitBonded: chunk k behind its header, on port k % BOND_PORTS */
+static void sendStriped(const uint8_t* data, uint32_t size, Case damage) {
+	uint16_t count = (size + BOND_CHUNK_SIZE - 1) / BOND_CHUNK_SIZE;
+	uint16_t order[MAX_DATA_SIZE / BOND_CHUNK_SIZE];
+	int route[MAX_DATA_SIZE / BOND_CHUNK_SIZE];
+
+	for(uint16_t k = 0; k < count; k++) {
+		order[k] = k;
+		route[k] = k % BOND_PORTS;
+	}
+
+	// The slow case needs three more chunks on the victim's port: two fill its buffers, the third is lost
+	uint16_t victim = rand() % ((damage == SLOW) ? count - 3 * BOND_PORTS : count);
+	if(damage == SHUFFLED) {
+		// Swap with a chunk on the same port or the one after, so the frame lengths may still match
+		uint16_t other = (victim + 1 + rand() % (2 * BOND_PORTS)) % count;
+		if(other == victim) {
+			other = (victim + 1) % count;
+		}
+		uint16_t swap = order[victim];
+		order[victim] = order[other];
+		order[other] = swap;
+	} else if(damage == MISROUTED) {
+		route[victim] = (route[victim] + 1 + rand() % (BOND_PORTS - 1)) % BOND_PORTS;
+	}
+
+	for(int i = 0; i < BOND_PORTS; i++) {
+		UART_HandleTypeDef* huart = bondPorts[i];
+		memset(huart, 0, sizeof(*huart));
+		huart->stall_at = UINT32_MAX;
+		huart->error_at = UINT32_MAX;
+		huart->pace = 30 + rand() % 71;
+	}
+
+	for(uint16_t slot = 0; slot < count; slot++) {
+		uint16_t seq = order[slot];
+		if(damage == DROPPED && slot == victim) {
+			continue;
+		}
+		UART_HandleTypeDef* huart = bondPorts[route[slot]];
+		uint32_t length = bondFrameLength(seq, size) - BOND_HEADER_SIZE;
+		chunks[seq].offset = huart->wire_len;
+		chunks[seq].length = BOND_HEADER_SIZE + length;
+		chunks[seq].port = route[slot];
+		bondPackHeader(&huart->wire[huart->wire_len], seq, (uint8_t)length);
+		huart->wire_len += BOND_HEADER_SIZE;
+		memcpy(&huart->wire[huart->wire_len], &data[(uint32_t)seq * BOND_CHUNK_SIZE], length);
+		huart->wire_len += length;
+	}
+
+	// Faults land inside the victim chunk's frame on its port
+	WireChunk* at = &chunks[victim];
+	if(damage == STALLED) {
+		bondPorts[at->port]->stall_at = at->offset + rand() % at->length;
+	} else if(damage == PORT_ERROR) {
+		bondPorts[at->port]->error_at = at->offset + rand() % at->length;
+	}
+
+	memset(bondRx, 0, sizeof(bondRx));  // No stale next_seq from the last payload
+	slowPort = (damage == SLOW) ? at->port : -1;
+	slowAfter = victim;
+}
+
+int main(int argc, char** argv) {
+	int payloads = 20000;
+	unsigned seed = 1;
+	int opt;
+
+	while((opt = getopt(argc, argv, "n:s:")) != -1) {
+		switch(opt) {
+		case 'n': payloads = atoi(optarg); break;
+		case 's': seed = (unsigned)atoi(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-n payloads] [-s seed]\n", argv[0]);
+			return 2;
+		}
+	}
+	srand(seed);
+
+	int runs[CASES] = {0}, passed[CASES] = {0}, wrong[CASES] = {0};
+	int waiting[CASES] = {0}, unsynced[CASES] = {0}, early[CASES] = {0};
+
+	for(int n = 0; n < payloads; n++) {
+		Case damage = (Case)(n % CASES);
+		uint32_t size = 1 + rand() % MAX_DATA_SIZE;
+		if(damage != CLEAN) {
+			// Room for the victim and three more chunks on every port
+			uint32_t least = 4 * BOND_PORTS * BOND_CHUNK_SIZE + 1;
+			size = least + rand() % (MAX_DATA_SIZE - least + 1);
+		}
+		for(uint32_t i = 0; i < size; i++) {
+			sent[i] = (uint8_t)rand();
+		}
+		memset(received, 0, size);
+
+		sendStriped(sent, size, damage);
+		lastError[0] = '\0';
+		prefixEnd = 0;
+		prefixEarly = false;
+		HAL_StatusTypeDef status = receiveBonded(received, size);
+
+		runs[damage]++;
+		waiting[damage] += strstr(lastError, "failed waiting") != NULL;
+		unsynced[damage] += strstr(lastError, "out of sync") != NULL;
+		early[damage] += prefixEarly;
+		if(status == HAL_OK) {
+			passed[damage]++;
+			if(memcmp(received, sent, size) != 0 || prefixEnd != size) {
+				wrong[damage]++;
+			}
+		}
+	}
+
+	int failed = 0;
+	for(int c = 0; c < CASES; c++) {
+		// Clean payloads must all pass, damaged ones must all fail, none may pass wrong.
+		// A port that stops, errors or overruns must be caught as such, not as a later resync.
+		bool ok = wrong[c] == 0 && early[c] == 0 && passed[c] == ((c == CLEAN) ? runs[c] : 0);
+		if(c == STALLED || c == PORT_ERROR || c == SLOW) {
+			ok = ok && waiting[c] == runs[c];
+		}
+		printf("%-10s %6d payloads, %6d reassembled, %d wrong, %d early prefix, failed: %5d port failed, %5d out of sync  %s\n",
+				caseNames[c], runs[c], passed[c], wrong[c], early[c], waiting[c], unsynced[c], ok ? "ok" : "FAILED");
+		failed |= !ok;
+	}
+	printf("%d bonded ports, %d ms simulated\n", BOND_PORTS, (int)tick);
+	return failed;
+}
@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+"""RAM and flash footprint of the firmware variants, checked against a budget.
+
+Reads the GNU ld map file (-Wl,-Map=...) or the ELF image of each variant and
+reports RAM and flash per module and per symbol. Per-symbol figures need the
+default CubeIDE -ffunction-sections -fdata-sections, so every function and
+static buffer lands in its own input section.
+
+    python3 tools/footprint.py --budget tools/footprint_budget.txt \\
+        FINAL_ENCODER=Debug/FINAL_ENCODER.map FINAL_DECODER=Debug/FINAL_DECODER.elf
+
+A bare path is reported under its file name without the extension. ELF input
+is read with $NM (default arm-none-eabi-nm). Exits 1 if anything is over
+budget, so the check can gate a build.
+"""
+import argparse
+import os
+import re
+import subprocess
+import sys
+from collections import defaultdict
+
+# Output sections by where they live. .data is copied from flash at boot.
+FLASH_SECTIONS = (".isr_vector", ".text", ".rodata", ".ARM.extab", ".ARM",
+                  ".preinit_array", ".init_array", ".fini_array")
+DATA_SECTIONS = (".data",)
+RAM_SECTIONS = (".bss", "._user_heap_stack")
+
+SECTION_PREFIXES = (".text.", ".rodata.", ".data.rel.ro.local.", ".data.rel.ro.",
+                    ".data.rel.local.", ".data.rel.", ".data.", ".bss.")
+
+OUTPUT_RE = re.compile(r"^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+OUTPUT_NAME_RE = re.compile(r"^(\.\S+)\s*$")
+INPUT_RE = re.compile(r"^ (\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s*(.*)$")
+INPUT_NAME_RE = re.compile(r"^ (\S+)\s*$")
+CONTINUATION_RE = re.compile(r"^\s{2,}0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s*(.*)$")
+
+
+class Symbol:
+    def __init__(self, name, module):
+        self.name = name
+        self.module = module
+        self.ram = 0
+        self.flash = 0
+
+
+class Footprint:
+    """Symbols keyed by (module, name), so statics of the same name stay apart."""
+
+    def __init__(self, variant):
+        self.variant = variant
+        self.symbols = {}
+
+    def add(self, name, module, ram, flash):
+        key = (module, name)
+        if key not in self.symbols:
+            self.symbols[key] = Symbol(name, module)
+        self.symbols[key].ram += ram
+        self.symbols[key].flash += flash
+
+    def totals(self):
+        return (sum(s.ram for s in self.symbols.values()),
+                sum(s.flash for s in self.symbols.values()))
+
+    def modules(self):
+        """RAM and flash per module - libraries are summed over their members."""
+        result = defaultdict(lambda: [0, 0])
+        for s in self.symbols.values():
+            result[moduleGroup(s.module)][0] += s.ram
+            result[moduleGroup(s.module)][1] += s.flash
+        return result
+
+    def usage(self, kind, name):
+        """kind bytes of the whole image ('*'), a module, or a symbol by name."""
+        index = 0 if kind == "ram" else 1
+        if name == "*":
+            return self.totals()[index]
+        modules = self.modules()
+        if name in modules:
+            return modules[name][index]
+        matches = [s for s in self.symbols.values() if s.name == name]
+        if not matches:
+            return None
+        return sum(s.ram if index == 0 else s.flash for s in matches)
+
+
+def moduleGroup(module):
+    """libc_nano.a(lib_a-vfprintf.o) -> libc_nano.a"""
+    if module.startswith("("):
+        return module
+    return module.split("(", 1)[0]
+
+
+def moduleName(path):
+    path = path.strip()
+    if not path:
+        return "(linker)"
+    if "(" in path:
+        archive, member = path.split("(", 1)
+        return os.path.basename(archive) + "(" + member
+    return os.path.basename(path)
+
+
+def symbolName(section):
+    for prefix in SECTION_PREFIXES:
+        if section.startswith(prefix) and len(section) > len(prefix):
+            return section[len(prefix):]
+    return "(" + section + ")"
+
+
+def placement(output):
+    """(ram, flash) multipliers for an output section, None for debug info."""
+    if output is None:
+        return None
+    if output.startswith(DATA_SECTIONS):
+        return (1, 1)
+    if output.startswith(RAM_SECTIONS):
+        return (1, 0)
+    if output.startswith(FLASH_SECTIONS):
+        return (0, 1)
+    return None
+
+
+def parseMap(path, variant):
+    footprint = Footprint(variant)
+    output = None
+    pendingOutput = None
+    pendingInput = None
+    inMap = False
+
+    with open(path, errors="replace") as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if not inMap:
+                inMap = line.startswith("Linker script and memory map")
+                continue
+
+            # Output section header, possibly wrapped onto the next line
+            if line and not line[0].isspace():
+                pendingInput = None
+                m = OUTPUT_RE.match(line)
+                if m:
+                    output = m.group(1)
+                    pendingOutput = None
+                    if output == "._user_heap_stack":
+                        footprint.add("(heap+stack)", "(linker)", int(m.group(3), 16), 0)
+                    continue
+                m = OUTPUT_NAME_RE.match(line)
+                pendingOutput = m.group(1) if m else None
+                continue
+
+            if pendingOutput:
+                m = CONTINUATION_RE.match(line)
+                output = pendingOutput
+                pendingOutput = None
+                if m and output == "._user_heap_stack":
+                    footprint.add("(heap+stack)", "(linker)", int(m.group(2), 16), 0)
+                continue
+
+            # Input section, possibly wrapped; symbol lines inside it are skipped
+            m = INPUT_RE.match(line)
+            if m:
+                section, size, obj = m.group(1), int(m.group(3), 16), m.group(4)
+                pendingInput = None
+            else:
+                m = INPUT_NAME_RE.match(line)
+                if m:
+                    pendingInput = m.group(1)
+                    continue
+                m = CONTINUATION_RE.match(line)
+                if not (m and pendingInput):
+                    continue
+                section, size, obj = pendingInput, int(m.group(2), 16), m.group(3)
+                pendingInput = None
+
+            where = placement(output)
+            if where is None or size == 0 or output == "._user_heap_stack":
+                continue
+            if section == "*fill*":
+                footprint.add("(fill)", "(linker)", size * where[0], size * where[1])
+            else:
+                footprint.add(symbolName(section), moduleName(obj), size * where[0], size * where[1])
+    return footprint
+
+
+def parseElf(path, variant):
+    nm = os.environ.get("NM", "arm-none-eabi-nm")
+    text = subprocess.run([nm, "-S", "-l", "--defined-only", path],
+                          check=True, capture_output=True, text=True).stdout
+    footprint = Footprint(variant)
+
+    for line in text.splitlines():
+        fields, _, source = line.partition("\t")
+        fields = fields.split()
+        if len(fields) != 4:
+            continue  # No size - labels and linker symbols
+        size, kind, name = int(fields[1], 16), fields[2].lower(), fields[3]
+        module = os.path.basename(source.rsplit(":", 1)[0]) if source else "(unknown)"
+        if kind in "twr":
+            footprint.add(name, module, 0, size)
+        elif kind == "d":
+            footprint.add(name, module, size, size)
+        elif kind == "b":
+            footprint.add(name, module, size, 0)
+    return footprint
+
+
+def load(arg):
+    if "=" in arg:
+        variant, path = arg.split("=", 1)
+    else:
+        variant, path = os.path.splitext(os.path.basename(arg))[0], arg
+    with open(path, "rb") as f:
+        isElf = f.read(4) == b"\x7fELF"
+    return parseElf(path, variant) if isElf else parseMap(path, variant)
+
+
+def loadBudget(path):
+    """Lines of: variant ram|flash name limit. Variant '*' applies to every
+    variant, name '*' is the whole image. Later lines override earlier ones."""
+    budget = {}
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            line = line.split("#", 1)[0].split()
+            if not line:
+                continue
+            if len(line) != 4 or line[1] not in ("ram", "flash"):
+                sys.exit("%s:%d: expected 'variant ram|flash name limit'" % (path, number))
+            budget[(line[0], line[1], line[2])] = int(line[3], 0)
+    return budget
+
+
+def report(footprint, top):
+    ram, flash = footprint.totals()
+    print("=== %s %s" % (footprint.variant, "=" * max(0, 44 - len(footprint.variant))))
+    print("RAM %d B, flash %d B" % (ram, flash))
+    print("%-32s %8s %8s" % ("Module", "RAM", "Flash"))
+    for name, (r, f) in sorted(footprint.modules().items(), key=lambda m: -(m[1][0] + m[1][1])):
+        print("%-32s %8d %8d" % (name, r, f))
+
+    print("%-32s %8s %8s  %s" % ("Symbol", "RAM", "Flash", "Module"))
+    symbols = sorted(footprint.symbols.values(), key=lambda s: -(s.ram + s.flash))
+    for s in symbols[:top]:
+        print("%-32s %8d %8d  %s" % (s.name, s.ram, s.flash, s.module))
+
+
+def check(footprint, budget):
+    """Print every budget line for this variant. Returns the number over."""
+    limits = {}
+    for (variant, kind, name), limit in budget.items():
+        if variant == "*" and (footprint.variant, kind, name) not in budget:
+            limits[(kind, name)] = limit
+        elif variant == footprint.variant:
+            limits[(kind, name)] = limit
+
+    over = 0
+    for (kind, name), limit in sorted(limits.items()):
+        used = footprint.usage(kind, name)
+        if used is None:
+            print("  %-5s %-26s not in image, budget %d" % (kind, name, limit))
+            continue
+        status = "OVER" if used > limit else "ok"
+        print("  %-5s %-26s %8d of %8d (%3d%%) %s" % (kind, name, used, limit,
+                                                   used * 100 // limit if limit else 100, status))
+        over += used > limit
+    return over
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("images", nargs="+", help="[variant=]map or ELF file")
+    parser.add_argument("--budget", help="budget file to check against")
+    parser.add_argument("--top", type=int, default=15, help="symbols to list per variant")
+    args = parser.parse_args()
+
+    budget = loadBudget(args.budget) if args.budget else {}
+    over = 0
+    for arg in args.images:
+        footprint = load(arg)
+        report(footprint, args.top)
+        if budget:
+            print("Budget:")
+            over += check(footprint, budget)
+        print()
+
+    if over:
+        print("%d budget line(s) exceeded" % over)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
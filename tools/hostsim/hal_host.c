@@ -0,0 +1,353 @@
+/**
+ ******************************************************************************
+ * @file           : hal_host.c
+ * @brief          : Host implementation of the HAL declared in main.h
+ ******************************************************************************
+ * Builds either board as a Linux program talking over the HOSTSIM transport.
+ * Set LINK_TRANSPORT to TRANSPORT_HOSTSIM in both files, then:
+ *
+ *   cc -O2 -Itools/hostsim -I. -o encoder FINAL_ENCODER.c tools/hostsim/hal_host.c
+ *   cc -O2 -Itools/hostsim -I. -o decoder FINAL_DECODER.c tools/hostsim/hal_host.c
+ *   cc -O2 -o link_pair tools/link_pair.c
+ *
+ *   ./link_pair                                   prints two pty paths
+ *   SECUREEDU_LINK=<first path> ./encoder         in one terminal
+ *   SECUREEDU_LINK=<second path> ./decoder        in another
+ *
+ * Debug output goes to stdout and the LCD is redrawn on stderr whenever it
+ * changes. Keys are read from stdin, one press per character (end the line
+ * with Enter): a, b, c and d are the encoder's A/B/C/ENTER buttons, and
+ * 0-9, A-D, * and # are the decoder's keypad.
+ */
+#define _GNU_SOURCE
+#include "main.h"
+#include "liquidcrystal_i2c.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+uint32_t SystemCoreClock = 84000000u;
+CoreDebug_Type hostCoreDebug;
+GPIO_TypeDef hostGpio[4];
+Peripheral_TypeDef hostPeripheral[8];
+DMA_Stream_TypeDef hostDmaStream[16];
+
+static void lcdDraw(void);
+
+/* Clock */
+static uint64_t hostStartNs = 0;
+
+static uint64_t hostNanos(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	uint64_t now = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+	if (hostStartNs == 0) {
+		hostStartNs = now;
+	}
+	return now - hostStartNs;
+}
+
+HAL_StatusTypeDef HAL_Init(void) {
+	setvbuf(stdout, NULL, _IONBF, 0);  // Interleave with the LCD on stderr as the board would
+	hostNanos();
+	return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void) {
+	lcdDraw();
+	return (uint32_t)(hostNanos() / 1000000u);
+}
+
+void HAL_Delay(uint32_t delay) {
+	lcdDraw();
+	usleep(delay * 1000u);
+}
+
+DWT_Type* hostDwt(void) {
+	static DWT_Type dwt;
+	dwt.CYCCNT = (uint32_t)(hostNanos() * (SystemCoreClock / 1000000u) / 1000u);
+	return &dwt;
+}
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef* init) { (void)init; return HAL_OK; }
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef* init, uint32_t latency) { (void)init; (void)latency; return HAL_OK; }
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preempt, uint32_t sub) { (void)irq; (void)preempt; (void)sub; }
+void HAL_NVIC_EnableIRQ(IRQn_Type irq) { (void)irq; }
+void HAL_NVIC_DisableIRQ(IRQn_Type irq) { (void)irq; }
+
+/* Keys - a press holds its pin against the pull for KEY_HOLD_MS. Buttons are
+ * pulled down and read high; keypad rows are pulled up and read low while
+ * their column is driven low. */
+#define KEY_HOLD_MS 150
+#define KEY_GAP_MS 100  // Released time before the next key, so every press is seen
+
+typedef struct {
+	char key;
+	GPIO_TypeDef* row_port;
+	uint16_t row_pin;
+	GPIO_TypeDef* col_port;  // NULL for a button
+	uint16_t col_pin;
+} HostKey;
+
+static const HostKey hostKeys[] = {
+	// Encoder buttons
+	{'a', GPIOA, GPIO_PIN_0, NULL, 0}, {'b', GPIOA, GPIO_PIN_1, NULL, 0},
+	{'c', GPIOA, GPIO_PIN_4, NULL, 0}, {'d', GPIOB, GPIO_PIN_0, NULL, 0},
+	// Decoder keypad, as KEYPAD_MAP
+	{'1', GPIOA, GPIO_PIN_0, GPIOB, GPIO_PIN_3}, {'2', GPIOA, GPIO_PIN_0, GPIOB, GPIO_PIN_5},
+	{'3', GPIOA, GPIO_PIN_0, GPIOB, GPIO_PIN_4}, {'A', GPIOA, GPIO_PIN_0, GPIOB, GPIO_PIN_10},
+	{'5', GPIOA, GPIO_PIN_1, GPIOB, GPIO_PIN_3}, {'4', GPIOA, GPIO_PIN_1, GPIOB, GPIO_PIN_5},
+	{'6', GPIOA, GPIO_PIN_1, GPIOB, GPIO_PIN_4}, {'B', GPIOA, GPIO_PIN_1, GPIOB, GPIO_PIN_10},
+	{'7', GPIOA, GPIO_PIN_4, GPIOB, GPIO_PIN_3}, {'8', GPIOA, GPIO_PIN_4, GPIOB, GPIO_PIN_5},
+	{'9', GPIOA, GPIO_PIN_4, GPIOB, GPIO_PIN_4}, {'C', GPIOA, GPIO_PIN_4, GPIOB, GPIO_PIN_10},
+	{'*', GPIOA, GPIO_PIN_3, GPIOB, GPIO_PIN_3}, {'0', GPIOA, GPIO_PIN_3, GPIOB, GPIO_PIN_5},
+	{'#', GPIOA, GPIO_PIN_3, GPIOB, GPIO_PIN_4}, {'D', GPIOA, GPIO_PIN_3, GPIOB, GPIO_PIN_10},
+};
+
+static const HostKey* keyHeld = NULL;
+static uint32_t keyChanged = 0;
+
+/* The held key, if any, after taking the next one from stdin when its turn comes */
+static const HostKey* keyPoll(void) {
+	uint32_t now = (uint32_t)(hostNanos() / 1000000u);
+
+	if (keyHeld != NULL) {
+		if (now - keyChanged < KEY_HOLD_MS) {
+			return keyHeld;
+		}
+		keyHeld = NULL;
+		keyChanged = now;
+	}
+	if (now - keyChanged < KEY_GAP_MS) {
+		return NULL;
+	}
+
+	struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+	char c;
+	while (poll(&pfd, 1, 0) > 0 && read(STDIN_FILENO, &c, 1) == 1) {
+		for (size_t i = 0; i < sizeof(hostKeys) / sizeof(hostKeys[0]); i++) {
+			if (hostKeys[i].key == c) {
+				keyHeld = &hostKeys[i];
+				keyChanged = now;
+				return keyHeld;
+			}
+		}
+	}
+	return NULL;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef* port, GPIO_InitTypeDef* init) {
+	if (init->Mode == GPIO_MODE_INPUT && init->Pull == GPIO_PULLUP) {
+		port->pullup |= init->Pin;
+	} else {
+		port->pullup &= ~init->Pin;
+	}
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state) {
+	if (state == GPIO_PIN_SET) {
+		port->odr |= pin;
+	} else {
+		port->odr &= ~(uint32_t)pin;
+	}
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* port, uint16_t pin) {
+	GPIO_PinState idle = (port->pullup & pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+	const HostKey* key = keyPoll();
+
+	if (key == NULL || key->row_port != port || key->row_pin != pin) {
+		return idle;
+	}
+	if (key->col_port == NULL) {
+		return (idle == GPIO_PIN_RESET) ? GPIO_PIN_SET : idle;
+	}
+	return (idle == GPIO_PIN_SET && !(key->col_port->odr & key->col_pin)) ? GPIO_PIN_RESET : idle;
+}
+
+/* LCD - 16x2 HD44780, fed by the library calls and by raw 4-bit I2C writes */
+#define LCD_HOST_COLS 16
+#define LCD_HOST_ROWS 2
+
+static char lcdText[LCD_HOST_ROWS][LCD_HOST_COLS];
+static uint8_t lcdAddress = 0;
+static int lcdDirty = 0;
+
+static void lcdCommand(uint8_t cmd) {
+	if (cmd == 0x01) {
+		memset(lcdText, ' ', sizeof(lcdText));
+		lcdAddress = 0;
+		lcdDirty = 1;
+	} else if (cmd == 0x02) {
+		lcdAddress = 0;
+	} else if (cmd & 0x80) {
+		lcdAddress = cmd & 0x7F;
+	}
+}
+
+static void lcdData(uint8_t c) {
+	uint8_t row = (lcdAddress >= 0x40) ? 1 : 0;
+	uint8_t col = lcdAddress - (row ? 0x40 : 0);
+	if (col < LCD_HOST_COLS) {
+		lcdText[row][col] = (c >= 0x20 && c < 0x7F) ? (char)c : '?';
+		lcdDirty = 1;
+	}
+	lcdAddress++;
+}
+
+/* Redraw once the firmware pauses or looks at the clock, not per character */
+static void lcdDraw(void) {
+	if (!lcdDirty) {
+		return;
+	}
+	lcdDirty = 0;
+	fprintf(stderr, "LCD [%.16s]\nLCD [%.16s]\n", lcdText[0], lcdText[1]);
+}
+
+void HD44780_Init(uint8_t rows) {
+	(void)rows;
+	lcdCommand(0x01);
+}
+
+void HD44780_Clear(void) {
+	lcdCommand(0x01);
+}
+
+void HD44780_SetCursor(uint8_t col, uint8_t row) {
+	lcdCommand(0x80 | (col + (row ? 0x40 : 0)));
+}
+
+void HD44780_PrintStr(const char c[]) {
+	while (*c) {
+		lcdData((uint8_t)*c++);
+	}
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef* hi2c) {
+	(void)hi2c;
+	return HAL_OK;
+}
+
+/* PCF8574 backpack: D7-D4 in the high nibble, EN 0x04, RS 0x01. A nibble is
+ * latched on the falling edge of EN, two make a byte. */
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef* hi2c, uint16_t address, uint8_t* data, uint16_t size, uint32_t timeout) {
+	static uint8_t enable = 0, high = 0, half = 0;
+	(void)hi2c; (void)address; (void)timeout;
+
+	for (uint16_t i = 0; i < size; i++) {
+		uint8_t b = data[i];
+		if (enable && !(b & 0x04)) {
+			if (!half) {
+				high = b & 0xF0;
+				half = 1;
+			} else {
+				uint8_t value = high | (b >> 4);
+				half = 0;
+				if (b & 0x01) {
+					lcdData(value);
+				} else {
+					lcdCommand(value);
+				}
+			}
+		}
+		enable = b & 0x04;
+	}
+	return HAL_OK;
+}
+
+/* UART - huart2 is the debug port on stdout, nothing else is wired */
+__attribute__((weak)) void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart) { (void)huart; }
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart) {
+	(void)huart;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size, uint32_t timeout) {
+	(void)timeout;
+	if (huart->Instance != USART2) {
+		return HAL_ERROR;
+	}
+	return (write(STDOUT_FILENO, data, size) == size) ? HAL_OK : HAL_ERROR;
+}
+
+/* Completes at once, so the callback runs before this returns */
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size) {
+	HAL_StatusTypeDef status = HAL_UART_Transmit(huart, data, size, HAL_MAX_DELAY);
+	if (status == HAL_OK) {
+		HAL_UART_TxCpltCallback(huart);
+	}
+	return status;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size, uint32_t timeout) {
+	(void)huart; (void)data; (void)size; (void)timeout;
+	return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size) {
+	(void)huart; (void)data; (void)size;
+	return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size) {
+	(void)huart; (void)data; (void)size;
+	return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size) {
+	(void)huart; (void)data; (void)size;
+	return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef* huart) { (void)huart; return HAL_OK; }
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef* huart) { (void)huart; return HAL_OK; }
+void HAL_UART_IRQHandler(UART_HandleTypeDef* huart) { (void)huart; }
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef* hdma) { (void)hdma; return HAL_OK; }
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef* hdma) { (void)hdma; }
+
+/* SPI and SD - not wired on the host */
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef* hspi) { (void)hspi; return HAL_OK; }
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef* hspi, const uint8_t* data, uint16_t size, uint32_t timeout) {
+	(void)hspi; (void)data; (void)size; (void)timeout;
+	return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef* hspi, uint8_t* data, uint16_t size, uint32_t timeout) {
+	(void)hspi; (void)data; (void)size; (void)timeout;
+	return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef* hspi, const uint8_t* tx, uint8_t* rx, uint16_t size, uint32_t timeout) {
+	(void)hspi; (void)tx; (void)rx; (void)size; (void)timeout;
+	return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef* hspi, const uint8_t* data, uint16_t size) {
+	(void)hspi; (void)data; (void)size;
+	return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef* hspi, uint8_t* data, uint16_t size) {
+	(void)hspi; (void)data; (void)size;
+	return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef* hspi) { (void)hspi; return HAL_OK; }
+void HAL_SPI_IRQHandler(SPI_HandleTypeDef* hspi) { (void)hspi; }
+
+HAL_StatusTypeDef HAL_SD_Init(SD_HandleTypeDef* hsd) { (void)hsd; return HAL_ERROR; }
+HAL_StatusTypeDef HAL_SD_ConfigWideBusOperation(SD_HandleTypeDef* hsd, uint32_t mode) { (void)hsd; (void)mode; return HAL_ERROR; }
+
+HAL_StatusTypeDef HAL_SD_ReadBlocks_IT(SD_HandleTypeDef* hsd, uint8_t* data, uint32_t block, uint32_t count) {
+	(void)hsd; (void)data; (void)block; (void)count;
+	return HAL_ERROR;
+}
+
+HAL_SD_CardStateTypeDef HAL_SD_GetCardState(SD_HandleTypeDef* hsd) { (void)hsd; return HAL_SD_CARD_ERROR; }
+void HAL_SD_IRQHandler(SD_HandleTypeDef* hsd) { (void)hsd; }
@@ -0,0 +1,18 @@
+/**
+ ******************************************************************************
+ * @file           : liquidcrystal_i2c.h
+ * @brief          : Host stand-in for the HD44780 I2C LCD library
+ ******************************************************************************
+ * The calls the firmware makes, drawn on stderr by hal_host.c.
+ */
+#ifndef HOSTSIM_LIQUIDCRYSTAL_I2C_H
+#define HOSTSIM_LIQUIDCRYSTAL_I2C_H
+
+#include <stdint.h>
+
+void HD44780_Init(uint8_t rows);
+void HD44780_Clear(void);
+void HD44780_SetCursor(uint8_t col, uint8_t row);
+void HD44780_PrintStr(const char c[]);
+
+#endif /* HOSTSIM_LIQUIDCRYSTAL_I2C_H */
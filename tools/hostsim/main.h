@@ -0,0 +1,260 @@
+/**
+ ******************************************************************************
+ * @file           : main.h
+ * @brief          : Host stand-in for the CubeMX main.h and STM32F4 HAL
+ ******************************************************************************
+ * Lets FINAL_ENCODER.c and FINAL_DECODER.c build as Linux programs with
+ * LINK_TRANSPORT set to TRANSPORT_HOSTSIM. Only the HAL the two files use is
+ * declared; hal_host.c implements it. Ticks and the cycle counter follow the
+ * host clock, the debug UART is stdout, the LCD is drawn on stderr and keys
+ * are read from stdin. Peripherals with no host counterpart (huart1, SPI, SD)
+ * report HAL_ERROR.
+ */
+#ifndef HOSTSIM_MAIN_H
+#define HOSTSIM_MAIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum { HAL_OK, HAL_ERROR, HAL_BUSY, HAL_TIMEOUT } HAL_StatusTypeDef;
+typedef enum { GPIO_PIN_RESET, GPIO_PIN_SET } GPIO_PinState;
+typedef int IRQn_Type;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFu
+
+/* Core */
+typedef struct { volatile uint32_t DEMCR; } CoreDebug_Type;
+typedef struct { volatile uint32_t CTRL, CYCCNT; } DWT_Type;
+
+extern CoreDebug_Type hostCoreDebug;
+DWT_Type* hostDwt(void);  // CYCCNT brought up to the host clock on every access
+
+#define CoreDebug (&hostCoreDebug)
+#define DWT (hostDwt())
+#define CoreDebug_DEMCR_TRCENA_Msk (1u << 24)
+#define DWT_CTRL_CYCCNTENA_Msk 1u
+
+extern uint32_t SystemCoreClock;
+
+#define __disable_irq() do {} while (0)
+#define __enable_irq() do {} while (0)
+#define __get_PRIMASK() 0u
+#define __set_PRIMASK(x) do { (void)(x); } while (0)
+#define __get_IPSR() 0u
+#define __DMB() __sync_synchronize()
+#define __WFI() do {} while (0)
+
+/* Peripheral instances - only their addresses matter on the host */
+typedef struct { uint32_t odr; uint32_t pullup; } GPIO_TypeDef;
+typedef struct { int unused; } Peripheral_TypeDef;
+typedef struct { volatile uint32_t NDTR; } DMA_Stream_TypeDef;
+
+extern GPIO_TypeDef hostGpio[4];
+extern Peripheral_TypeDef hostPeripheral[8];
+extern DMA_Stream_TypeDef hostDmaStream[16];
+
+#define GPIOA (&hostGpio[0])
+#define GPIOB (&hostGpio[1])
+#define GPIOC (&hostGpio[2])
+#define GPIOD (&hostGpio[3])
+#define USART1 (&hostPeripheral[0])
+#define USART2 (&hostPeripheral[1])
+#define USART6 (&hostPeripheral[2])
+#define I2C1 (&hostPeripheral[3])
+#define SPI1 (&hostPeripheral[4])
+#define SPI2 (&hostPeripheral[5])
+#define SDIO (&hostPeripheral[6])
+#define DMA1_Stream3 (&hostDmaStream[3])
+#define DMA1_Stream4 (&hostDmaStream[4])
+#define DMA1_Stream5 (&hostDmaStream[5])
+#define DMA1_Stream6 (&hostDmaStream[6])
+#define DMA2_Stream0 (&hostDmaStream[8])
+#define DMA2_Stream1 (&hostDmaStream[9])
+#define DMA2_Stream2 (&hostDmaStream[10])
+#define DMA2_Stream3 (&hostDmaStream[11])
+#define DMA2_Stream4 (&hostDmaStream[12])
+#define DMA2_Stream5 (&hostDmaStream[13])
+#define DMA2_Stream6 (&hostDmaStream[14])
+#define DMA2_Stream7 (&hostDmaStream[15])
+
+enum {
+	DMA1_Stream3_IRQn, DMA1_Stream4_IRQn, DMA1_Stream5_IRQn, DMA1_Stream6_IRQn,
+	DMA2_Stream0_IRQn, DMA2_Stream1_IRQn, DMA2_Stream2_IRQn, DMA2_Stream3_IRQn,
+	DMA2_Stream4_IRQn, DMA2_Stream5_IRQn, DMA2_Stream6_IRQn, DMA2_Stream7_IRQn,
+	USART1_IRQn, USART2_IRQn, USART6_IRQn, SPI1_IRQn, SPI2_IRQn, SDIO_IRQn
+};
+
+/* Handles - the Init fields the firmware fills in, nothing more */
+typedef struct {
+	DMA_Stream_TypeDef* Instance;
+	struct {
+		uint32_t Channel, Direction, PeriphInc, MemInc, PeriphDataAlignment,
+				MemDataAlignment, Mode, Priority, FIFOMode;
+	} Init;
+	void* Parent;
+} DMA_HandleTypeDef;
+
+typedef struct {
+	Peripheral_TypeDef* Instance;
+	struct { uint32_t BaudRate, WordLength, StopBits, Parity, Mode, HwFlowCtl, OverSampling; } Init;
+	DMA_HandleTypeDef* hdmatx;
+	DMA_HandleTypeDef* hdmarx;
+} UART_HandleTypeDef;
+
+typedef struct {
+	Peripheral_TypeDef* Instance;
+	struct {
+		uint32_t ClockSpeed, DutyCycle, OwnAddress1, AddressingMode, DualAddressMode,
+				OwnAddress2, GeneralCallMode, NoStretchMode;
+	} Init;
+} I2C_HandleTypeDef;
+
+typedef struct {
+	Peripheral_TypeDef* Instance;
+	struct {
+		uint32_t Mode, Direction, DataSize, CLKPolarity, CLKPhase, NSS, BaudRatePrescaler,
+				FirstBit, TIMode, CRCCalculation, CRCPolynomial;
+	} Init;
+	DMA_HandleTypeDef* hdmatx;
+	DMA_HandleTypeDef* hdmarx;
+} SPI_HandleTypeDef;
+
+typedef struct {
+	Peripheral_TypeDef* Instance;
+	struct { uint32_t ClockEdge, ClockBypass, ClockPowerSave, BusWide, HardwareFlowControl, ClockDiv; } Init;
+} SD_HandleTypeDef;
+
+typedef enum { HAL_SD_CARD_READY = 1, HAL_SD_CARD_TRANSFER = 4, HAL_SD_CARD_ERROR = 0xFF } HAL_SD_CardStateTypeDef;
+
+typedef struct { uint32_t Pin, Mode, Pull, Speed, Alternate; } GPIO_InitTypeDef;
+
+typedef struct {
+	uint32_t OscillatorType, HSIState, HSICalibrationValue;
+	struct { uint32_t PLLState, PLLSource, PLLM, PLLN, PLLP, PLLQ; } PLL;
+} RCC_OscInitTypeDef;
+
+typedef struct { uint32_t ClockType, SYSCLKSource, AHBCLKDivider, APB1CLKDivider, APB2CLKDivider; } RCC_ClkInitTypeDef;
+
+/* Init constants - values are never looked at on the host */
+#define GPIO_PIN_0 0x0001u
+#define GPIO_PIN_1 0x0002u
+#define GPIO_PIN_2 0x0004u
+#define GPIO_PIN_3 0x0008u
+#define GPIO_PIN_4 0x0010u
+#define GPIO_PIN_5 0x0020u
+#define GPIO_PIN_6 0x0040u
+#define GPIO_PIN_7 0x0080u
+#define GPIO_PIN_8 0x0100u
+#define GPIO_PIN_9 0x0200u
+#define GPIO_PIN_10 0x0400u
+#define GPIO_PIN_11 0x0800u
+#define GPIO_PIN_12 0x1000u
+#define GPIO_PIN_13 0x2000u
+#define GPIO_PIN_14 0x4000u
+#define GPIO_PIN_15 0x8000u
+
+enum { GPIO_NOPULL, GPIO_PULLUP, GPIO_PULLDOWN };
+enum {
+	GPIO_MODE_INPUT, GPIO_MODE_OUTPUT_PP, GPIO_MODE_AF_PP, GPIO_MODE_AF_OD,
+	GPIO_SPEED_FREQ_LOW, GPIO_SPEED_FREQ_HIGH, GPIO_SPEED_FREQ_VERY_HIGH,
+	GPIO_AF4_I2C1, GPIO_AF5_SPI1, GPIO_AF5_SPI2, GPIO_AF7_USART1, GPIO_AF7_USART2,
+	GPIO_AF8_USART6, GPIO_AF12_SDIO
+};
+enum {
+	UART_WORDLENGTH_8B, UART_STOPBITS_1, UART_PARITY_NONE, UART_MODE_TX_RX, UART_MODE_TX,
+	UART_MODE_RX, UART_HWCONTROL_NONE, UART_OVERSAMPLING_16, UART_OVERSAMPLING_8
+};
+enum { I2C_DUTYCYCLE_2, I2C_ADDRESSINGMODE_7BIT, I2C_DUALADDRESS_DISABLE, I2C_GENERALCALL_DISABLE, I2C_NOSTRETCH_DISABLE };
+enum {
+	SPI_MODE_MASTER, SPI_MODE_SLAVE, SPI_DIRECTION_2LINES, SPI_DATASIZE_8BIT, SPI_POLARITY_LOW,
+	SPI_PHASE_1EDGE, SPI_NSS_SOFT, SPI_NSS_HARD_INPUT, SPI_BAUDRATEPRESCALER_2,
+	SPI_BAUDRATEPRESCALER_4, SPI_BAUDRATEPRESCALER_8, SPI_BAUDRATEPRESCALER_16, SPI_FIRSTBIT_MSB,
+	SPI_TIMODE_DISABLE, SPI_CRCCALCULATION_DISABLE
+};
+enum {
+	DMA_CHANNEL_0, DMA_CHANNEL_3, DMA_CHANNEL_4, DMA_CHANNEL_5, DMA_MEMORY_TO_PERIPH,
+	DMA_PERIPH_TO_MEMORY, DMA_PINC_DISABLE, DMA_MINC_ENABLE, DMA_MINC_DISABLE, DMA_PDATAALIGN_BYTE,
+	DMA_MDATAALIGN_BYTE, DMA_NORMAL, DMA_CIRCULAR, DMA_PRIORITY_LOW, DMA_PRIORITY_HIGH,
+	DMA_PRIORITY_VERY_HIGH, DMA_FIFOMODE_DISABLE
+};
+enum {
+	SDIO_CLOCK_EDGE_RISING, SDIO_CLOCK_BYPASS_DISABLE, SDIO_CLOCK_POWER_SAVE_DISABLE,
+	SDIO_BUS_WIDE_1B, SDIO_BUS_WIDE_4B, SDIO_HARDWARE_FLOW_CONTROL_DISABLE
+};
+enum {
+	RCC_OSCILLATORTYPE_HSI, RCC_HSI_ON, RCC_HSICALIBRATION_DEFAULT, RCC_PLL_ON, RCC_PLLSOURCE_HSI,
+	RCC_PLLP_DIV4, RCC_SYSCLKSOURCE_PLLCLK, RCC_SYSCLK_DIV1, RCC_HCLK_DIV1, RCC_HCLK_DIV2,
+	FLASH_LATENCY_2, PWR_REGULATOR_VOLTAGE_SCALE2
+};
+#define RCC_CLOCKTYPE_HCLK 0x1u
+#define RCC_CLOCKTYPE_SYSCLK 0x2u
+#define RCC_CLOCKTYPE_PCLK1 0x4u
+#define RCC_CLOCKTYPE_PCLK2 0x8u
+enum { UART_IT_IDLE, UART_FLAG_IDLE };
+
+#define __HAL_RCC_PWR_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_GPIOA_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_GPIOC_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_GPIOD_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_GPIOH_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_DMA1_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_DMA2_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_USART6_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_SPI1_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_SPI2_CLK_ENABLE() do {} while (0)
+#define __HAL_RCC_SDIO_CLK_ENABLE() do {} while (0)
+#define __HAL_PWR_VOLTAGESCALING_CONFIG(x) do { (void)(x); } while (0)
+#define __HAL_LINKDMA(h, field, dma) do { (h)->field = &(dma); (dma).Parent = (h); } while (0)
+#define __HAL_DMA_GET_COUNTER(h) ((h)->Instance->NDTR)
+
+/* HAL */
+HAL_StatusTypeDef HAL_Init(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t delay);
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef* init);
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef* init, uint32_t latency);
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preempt, uint32_t sub);
+void HAL_NVIC_EnableIRQ(IRQn_Type irq);
+void HAL_NVIC_DisableIRQ(IRQn_Type irq);
+
+void HAL_GPIO_Init(GPIO_TypeDef* port, GPIO_InitTypeDef* init);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* port, uint16_t pin);
+void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state);
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef* hdma);
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef* hdma);
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef* huart);
+void HAL_UART_IRQHandler(UART_HandleTypeDef* huart);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart);
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef* hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef* hi2c, uint16_t address, uint8_t* data, uint16_t size, uint32_t timeout);
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef* hspi);
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef* hspi, const uint8_t* data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef* hspi, uint8_t* data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef* hspi, const uint8_t* tx, uint8_t* rx, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef* hspi, const uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef* hspi, uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef* hspi);
+void HAL_SPI_IRQHandler(SPI_HandleTypeDef* hspi);
+
+HAL_StatusTypeDef HAL_SD_Init(SD_HandleTypeDef* hsd);
+HAL_StatusTypeDef HAL_SD_ConfigWideBusOperation(SD_HandleTypeDef* hsd, uint32_t mode);
+HAL_StatusTypeDef HAL_SD_ReadBlocks_IT(SD_HandleTypeDef* hsd, uint8_t* data, uint32_t block, uint32_t count);
+HAL_SD_CardStateTypeDef HAL_SD_GetCardState(SD_HandleTypeDef* hsd);
+void HAL_SD_IRQHandler(SD_HandleTypeDef* hsd);
+
+void Error_Handler(void);
+
+#endif /* HOSTSIM_MAIN_H */
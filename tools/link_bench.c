@@ -0,0 +1,195 @@
+/**
+ ******************************************************************************
+ * @file           : link_bench.c
+ * @brief          : Host build of the firmware loopback link benchmark
+ ******************************************************************************
+ * Runs the same sweep as runLinkBenchmark() in FINAL_ENCODER.c / FINAL_DECODER.c
+ * over a pty pair instead of a PA9->PA10 jumper. Wire time is emulated from the
+ * baud rate and a noise model corrupts or drops bytes on the way through.
+ *
+ *   cc -O2 -o link_bench tools/link_bench.c
+ *   ./link_bench [-e bit_error_rate] [-d byte_drop_rate] [-s seed]
+ *
+ * Output lines match the firmware report so results can be compared directly:
+ * corrupt counts chunks that arrived wrong, timeouts those that never arrived.
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Sweep - keep in step with the firmware tables */
+#define BENCH_BYTES_PER_RUN 4096
+#define BENCH_MAX_CHUNKS (BENCH_BYTES_PER_RUN / 16)
+/* The firmware waits BENCH_RX_SLACK_US (20 ms) past the wire time. A pty read
+ * can be held up that long by the host scheduler alone, so the host waits
+ * longer; a chunk that is slow but intact shows up in the latency percentiles
+ * rather than as a timeout. */
+#define BENCH_RX_SLACK_US 200000
+
+static const uint32_t BENCH_BAUDS[] = {115200, 230400, 460800, 921600};
+static const uint16_t BENCH_CHUNKS[] = {16, 32, 64, 128, 256};
+static const uint16_t BENCH_GAPS[] = {0, 2, 10};
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+/* Noise model */
+static double bitErrorRate = 0.0;
+static double byteDropRate = 0.0;
+
+static uint64_t nowMicros(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000u;
+}
+
+static int chance(double p) {
+	return p > 0.0 && (double)rand() / RAND_MAX < p;
+}
+
+/* Push a chunk through the noise model into the pty. Returns bytes written. */
+static size_t noisyWrite(int fd, const uint8_t* data, size_t length) {
+	uint8_t wire[256];
+	size_t n = 0;
+
+	for (size_t i = 0; i < length; i++) {
+		if (chance(byteDropRate)) {
+			continue;
+		}
+		uint8_t b = data[i];
+		for (int bit = 0; bit < 8; bit++) {
+			if (chance(bitErrorRate)) {
+				b ^= (uint8_t)(1u << bit);
+			}
+		}
+		wire[n++] = b;
+	}
+	return (n > 0 && write(fd, wire, n) != (ssize_t)n) ? 0 : n;
+}
+
+/* Read exactly length bytes or give up at the deadline */
+static int readChunk(int fd, uint8_t* data, size_t length, uint64_t deadline) {
+	size_t got = 0;
+
+	while (got < length) {
+		uint64_t now = nowMicros();
+		if (now >= deadline) {
+			return -1;
+		}
+		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+		if (poll(&pfd, 1, (int)((deadline - now) / 1000) + 1) <= 0) {
+			continue;
+		}
+		ssize_t r = read(fd, &data[got], length - got);
+		if (r > 0) {
+			got += (size_t)r;
+		}
+	}
+	return 0;
+}
+
+static void drain(int fd) {
+	uint8_t scratch[256];
+	while (read(fd, scratch, sizeof(scratch)) > 0) {
+	}
+}
+
+static int compareU32(const void* a, const void* b) {
+	uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+}
+
+static void runOne(int tx, int rx, uint32_t baud, uint16_t chunk, uint16_t gap) {
+	static uint32_t latencies[BENCH_MAX_CHUNKS];
+	uint8_t txData[256], rxData[256];
+	uint32_t chunks = BENCH_BYTES_PER_RUN / chunk;
+	uint32_t corrupt = 0, timeouts = 0, goodBytes = 0;
+	uint64_t wireUs = (uint64_t)chunk * 10u * 1000000u / baud;  // 8N1 = 10 bits per byte
+
+	uint64_t start = nowMicros();
+	for (uint32_t c = 0; c < chunks; c++) {
+		for (uint16_t i = 0; i < chunk; i++) {
+			txData[i] = (uint8_t)(c * 31u + i * 7u + 0x5A);
+		}
+
+		uint64_t t0 = nowMicros();
+		noisyWrite(tx, txData, chunk);
+		usleep((useconds_t)wireUs);
+		int arrived = readChunk(rx, rxData, chunk, t0 + wireUs + BENCH_RX_SLACK_US) == 0;
+		latencies[c] = (uint32_t)(nowMicros() - t0);
+
+		if (!arrived) {
+			timeouts++;
+			drain(rx);
+		} else if (memcmp(txData, rxData, chunk) != 0) {
+			corrupt++;
+		} else {
+			goodBytes += chunk;
+		}
+		if (gap) {
+			usleep(gap * 1000u);
+		}
+	}
+	uint64_t elapsed = nowMicros() - start;
+
+	qsort(latencies, chunks, sizeof(latencies[0]), compareU32);
+	printf("baud=%lu chunk=%u gap=%u goodput=%lu B/s corrupt=%lu/%lu timeouts=%lu/%lu p50=%lu us p90=%lu us p99=%lu us max=%lu us\n",
+			(unsigned long)baud, chunk, gap,
+			(unsigned long)(elapsed ? (uint64_t)goodBytes * 1000000u / elapsed : 0),
+			(unsigned long)corrupt, (unsigned long)chunks, (unsigned long)timeouts, (unsigned long)chunks,
+			(unsigned long)latencies[chunks * 50 / 100], (unsigned long)latencies[chunks * 90 / 100],
+			(unsigned long)latencies[chunks * 99 / 100], (unsigned long)latencies[chunks - 1]);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+	unsigned seed = 1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "e:d:s:")) != -1) {
+		switch (opt) {
+		case 'e': bitErrorRate = atof(optarg); break;
+		case 'd': byteDropRate = atof(optarg); break;
+		case 's': seed = (unsigned)strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-e bit_error_rate] [-d byte_drop_rate] [-s seed]\n", argv[0]);
+			return 2;
+		}
+	}
+	srand(seed);
+
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+		perror("posix_openpt");
+		return 1;
+	}
+	int slave = open(ptsname(master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (slave < 0) {
+		perror("open pty slave");
+		return 1;
+	}
+
+	struct termios raw;
+	tcgetattr(slave, &raw);
+	cfmakeraw(&raw);
+	tcsetattr(slave, TCSANOW, &raw);
+
+	printf("=== Link Benchmark (pty, ber=%g, drop=%g) ===\n", bitErrorRate, byteDropRate);
+	for (size_t b = 0; b < COUNT_OF(BENCH_BAUDS); b++) {
+		for (size_t c = 0; c < COUNT_OF(BENCH_CHUNKS); c++) {
+			for (size_t g = 0; g < COUNT_OF(BENCH_GAPS); g++) {
+				runOne(master, slave, BENCH_BAUDS[b], BENCH_CHUNKS[c], BENCH_GAPS[g]);
+			}
+		}
+	}
+
+	close(slave);
+	close(master);
+	return 0;
+}
@@ -0,0 +1,112 @@
+/**
+ ******************************************************************************
+ * @file           : link_pair.c
+ * @brief          : Null-modem pty pair for the HOSTSIM link transport
+ ******************************************************************************
+ * Opens two ptys, prints the path of each, and copies every byte written to
+ * one across to the other, as the huart1 cross-over cable does between the
+ * boards. Point the encoder's SECUREEDU_LINK at the first path and the
+ * decoder's at the second (see tools/hostsim/hal_host.c for the build).
+ *
+ *   cc -O2 -o link_pair tools/link_pair.c
+ *   ./link_pair [-v]
+ *
+ * Both ends are raw, so frame bytes pass through untouched. -v logs the byte
+ * count of every transfer on stderr. Runs until interrupted.
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+typedef struct {
+	int master;
+	int slave;  // Held open so the pty survives a board restarting, and keeps its settings
+	const char* path;
+} PtyEnd;
+
+static int openEnd(PtyEnd* end) {
+	end->master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (end->master < 0 || grantpt(end->master) != 0 || unlockpt(end->master) != 0) {
+		perror("posix_openpt");
+		return -1;
+	}
+	const char* name = ptsname(end->master);  // Static - the next call overwrites it
+	end->path = name ? strdup(name) : NULL;
+	end->slave = end->path ? open(end->path, O_RDWR | O_NOCTTY) : -1;
+	if (end->slave < 0) {
+		perror("open pty slave");
+		return -1;
+	}
+
+	struct termios raw;
+	tcgetattr(end->slave, &raw);
+	cfmakeraw(&raw);
+	tcsetattr(end->slave, TCSANOW, &raw);
+	return 0;
+}
+
+/* Copy what is waiting on from's master to to's master. Returns -1 on error. */
+static int relay(const PtyEnd* from, const PtyEnd* to, int verbose, const char* name) {
+	unsigned char buffer[4096];
+	ssize_t n = read(from->master, buffer, sizeof(buffer));
+	if (n <= 0) {
+		return (n == 0) ? 0 : -1;
+	}
+	for (ssize_t done = 0; done < n;) {
+		ssize_t w = write(to->master, buffer + done, (size_t)(n - done));
+		if (w <= 0) {
+			return -1;
+		}
+		done += w;
+	}
+	if (verbose) {
+		fprintf(stderr, "%s %zd bytes\n", name, n);
+	}
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	PtyEnd encoder, decoder;
+	int verbose = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "v")) != -1) {
+		switch (opt) {
+		case 'v': verbose = 1; break;
+		default:
+			fprintf(stderr, "usage: %s [-v]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (openEnd(&encoder) != 0 || openEnd(&decoder) != 0) {
+		return 1;
+	}
+	printf("encoder: SECUREEDU_LINK=%s\n", encoder.path);
+	printf("decoder: SECUREEDU_LINK=%s\n", decoder.path);
+	fflush(stdout);
+
+	for (;;) {
+		struct pollfd fds[2] = {
+			{ .fd = encoder.master, .events = POLLIN },
+			{ .fd = decoder.master, .events = POLLIN },
+		};
+		if (poll(fds, 2, -1) < 0) {
+			perror("poll");
+			return 1;
+		}
+		if ((fds[0].revents & POLLIN) && relay(&encoder, &decoder, verbose, "encoder->decoder") != 0) {
+			perror("relay");
+			return 1;
+		}
+		if ((fds[1].revents & POLLIN) && relay(&decoder, &encoder, verbose, "decoder->encoder") != 0) {
+			perror("relay");
+			return 1;
+		}
+	}
+}
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Pack a directory of lesson text into the encoder's flash content catalog.
+
+Every *.txt file is one paragraph, taken in file name order; every non-blank
+line in it is one line of that paragraph. The result is a C header holding
+the catalog blob, for the encoder to link into flash:
+
+    python3 tools/pack_catalog.py content -o content_catalog.h
+
+Blob layout, all fields little-endian:
+
+    "CCAT"                          magic
+    u16 version, u16 paragraphs
+    u32 lines                       across all paragraphs
+    u16 block_size, u16 blocks      0, 0 for uncompressed text
+    u32 first[paragraphs + 1]       global number of each paragraph's first line
+    u32 offset[lines + 1]           start of each line in the text
+    u32 block[blocks + 1]           start of each compressed block, if any
+    data                            the text, or its compressed blocks
+
+The text is every line followed by one NUL. A line's length plus its
+terminator is offset[n + 1] - offset[n], so the offset table doubles as a
+prefix sum of '\\n'-terminated line lengths. Offsets are always into the
+uncompressed text.
+
+Unless --raw is given the text is cut into block_size pieces, each LZ77
+compressed on its own so a reader can start at any block. A block is a run
+of sequences:
+
+    token                           high nibble literal count, low nibble match code
+    [literal count extension]       if the nibble is 15: bytes added until one is < 255
+    [match code extension]          the same, for a match code of 15
+    [distance - 1]                  one byte, if the match code is not 0
+    literals
+                                    then match code + MATCH_MIN - 1 bytes copied
+                                    from distance bytes back
+
+Distances are at most WINDOW_SIZE, so the decoder only keeps that much
+history. --binary also writes the raw blob, for an encoder built with an
+external content store: program it at STORE_CATALOG_ADDRESS of the SPI NOR,
+or dd it onto the SD card from that byte offset.
+"""
+import argparse
+import os
+import struct
+import sys
+
+CATALOG_MAGIC = b"CCAT"
+CATALOG_VERSION = 2
+
+WINDOW_SIZE = 256  # Must match CATALOG_WINDOW in the firmware
+MATCH_MIN = 3
+MATCH_MAX = 1024   # Keeps extension runs short
+
+
+def readParagraphs(directory):
+    names = sorted(n for n in os.listdir(directory) if n.endswith(".txt"))
+    if not names:
+        sys.exit("pack_catalog: no .txt files in %s" % directory)
+
+    paragraphs = []
+    for name in names:
+        with open(os.path.join(directory, name), encoding="utf-8") as f:
+            lines = [line.rstrip() for line in f if line.strip()]
+        if not lines:
+            sys.exit("pack_catalog: %s has no lines" % name)
+        for line in lines:
+            try:
+                line.encode("ascii")
+            except UnicodeEncodeError:
+                sys.exit("pack_catalog: %s: non-ASCII text cannot be shown on the LCD" % name)
+        paragraphs.append(lines)
+    return names, paragraphs
+
+
+def lengthCode(value):
+    """Nibble plus extension bytes for a literal count or match code."""
+    if value < 15:
+        return value, b""
+    value -= 15
+    extension = bytearray()
+    while value >= 255:
+        extension.append(255)
+        value -= 255
+    extension.append(value)
+    return 15, bytes(extension)
+
+
+def sequence(literals, match, distance):
+    literalNibble, literalExtension = lengthCode(len(literals))
+    code = match - MATCH_MIN + 1 if match else 0
+    matchNibble, matchExtension = lengthCode(code)
+    out = bytearray([literalNibble << 4 | matchNibble])
+    out += literalExtension + matchExtension
+    if match:
+        out.append(distance - 1)
+    out += literals
+    return out
+
+
+def compressBlock(data):
+    """Greedy LZ77 over a WINDOW_SIZE window, hash chained on MATCH_MIN bytes."""
+    out = bytearray()
+    chains = {}
+    literalStart = 0
+    i = 0
+    while i < len(data):
+        best, bestDistance = 0, 0
+        if i + MATCH_MIN <= len(data):
+            for j in reversed(chains.get(data[i:i + MATCH_MIN], ())):
+                if i - j > WINDOW_SIZE:
+                    break
+                length = 0
+                while (i + length < len(data) and length < MATCH_MAX and
+                       data[j + length] == data[i + length]):
+                    length += 1
+                if length > best:
+                    best, bestDistance = length, i - j
+        if best < MATCH_MIN:
+            chains.setdefault(data[i:i + MATCH_MIN], []).append(i)
+            i += 1
+            continue
+
+        out += sequence(data[literalStart:i], best, bestDistance)
+        for k in range(i, i + best):
+            chains.setdefault(data[k:k + MATCH_MIN], []).append(k)
+        i += best
+        literalStart = i
+    if literalStart < len(data):
+        out += sequence(data[literalStart:], 0, 0)
+    return bytes(out)
+
+
+def pack(paragraphs, blockSize):
+    first = [0]
+    for lines in paragraphs:
+        first.append(first[-1] + len(lines))
+
+    text = bytearray()
+    offsets = []
+    for lines in paragraphs:
+        for line in lines:
+            offsets.append(len(text))
+            text += line.encode("ascii") + b"\0"
+    offsets.append(len(text))
+
+    blocks = []
+    data = bytes(text)
+    if blockSize:
+        starts = [0]
+        data = bytearray()
+        for i in range(0, len(text), blockSize):
+            data += compressBlock(bytes(text[i:i + blockSize]))
+            starts.append(len(data))
+        blocks = starts
+
+    blob = bytearray(CATALOG_MAGIC)
+    blob += struct.pack("<HHIHH", CATALOG_VERSION, len(paragraphs), first[-1],
+                        blockSize, max(len(blocks) - 1, 0))
+    blob += struct.pack("<%dI" % len(first), *first)
+    blob += struct.pack("<%dI" % len(offsets), *offsets)
+    blob += struct.pack("<%dI" % len(blocks), *blocks)
+    blob += data
+    return bytes(blob), len(text)
+
+
+def writeHeader(path, blob, names, source):
+    with open(path, "w") as f:
+        f.write("/* Content catalog - generated by tools/pack_catalog.py from %s/, do not edit.\n" % source)
+        f.write(" * %d paragraphs, %d bytes:\n" % (len(names), len(blob)))
+        for i, name in enumerate(names):
+            f.write(" *   %d  %s\n" % (i, name))
+        f.write(" */\n")
+        f.write("#ifndef CONTENT_CATALOG_H\n#define CONTENT_CATALOG_H\n\n")
+        f.write("#include <stdint.h>\n\n")
+        f.write("static const uint8_t CONTENT_CATALOG[%d] __attribute__((aligned(4))) = {\n" % len(blob))
+        for i in range(0, len(blob), 16):
+            f.write("\t" + ", ".join("0x%02X" % b for b in blob[i:i + 16]) + ",\n")
+        f.write("};\n\n#endif /* CONTENT_CATALOG_H */\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("directory", help="directory of paragraph .txt files")
+    parser.add_argument("-o", "--output", default="content_catalog.h", help="C header to write")
+    parser.add_argument("--binary", help="also write the raw blob here")
+    parser.add_argument("--block-size", type=int, default=1024, help="uncompressed bytes per block")
+    parser.add_argument("--raw", action="store_true", help="store the text uncompressed")
+    args = parser.parse_args()
+    if not args.raw and not 0 < args.block_size < 65536:
+        sys.exit("pack_catalog: block size must be 1..65535")
+
+    names, paragraphs = readParagraphs(args.directory)
+    blob, textSize = pack(paragraphs, 0 if args.raw else args.block_size)
+    writeHeader(args.output, blob, names, os.path.basename(os.path.normpath(args.directory)))
+    if args.binary:
+        with open(args.binary, "wb") as f:
+            f.write(blob)
+
+    print("%d paragraphs, %d lines, text %d bytes, catalog %d bytes (%d%% of raw text plus index)" % (
+        len(paragraphs), sum(map(len, paragraphs)), textSize, len(blob),
+        len(blob) * 100 // len(pack(paragraphs, 0)[0])))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,216 @@
+/**
+ ******************************************************************************
+ * @file           : pool_soak.c
+ * @brief          : Host soak test of the decoder block pool
+ ******************************************************************************
+ * Runs poolInit / poolAlloc / poolFree from block_pool.h, the allocator both
+ * decoder boards include, with FINAL_DECODER.c's block counts (or
+ * lcd_communication_decode.c's, see below) through three phases:
+ *
+ *   frames      one frame at a time as the decoder receives them: the
+ *               payload block, then for a compressed frame the block its
+ *               text inflates to - every valid frame must get both
+ *   sweep       every payload size against every text size for compressed
+ *               frames, in steps - none may fail
+ *   random      random sizes allocated and freed out of order with up to
+ *               OUTSTANDING blocks live - a request may only fail when its
+ *               class and every larger one is empty
+ *
+ * Every live block is filled with a tag and checked when it is freed, so
+ * overlapping blocks show up. At the end no bytes may be in use and every
+ * free list must hold its whole class.
+ *
+ *   cc -O2 -I. -o pool_soak tools/pool_soak.c
+ *   cc -O2 -I. -DPOOL_BOARD=POOL_BOARD_LCD_DECODE -o pool_soak_lcd tools/pool_soak.c
+ *   ./pool_soak [-n iterations] [-s seed]
+ *
+ * A board without compressed frames only gets the payload block, and skips
+ * the sweep.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* The pool under test is the decoders' own, with one board's configuration.
+ * -DPOOL_BOARD=POOL_BOARD_LCD_DECODE soaks lcd_communication_decode.c's. */
+#define MAX_DATA_SIZE 10240  // As on both decoder boards
+#ifndef POOL_BOARD
+#define POOL_BOARD POOL_BOARD_FINAL_DECODER
+#endif
+
+void Error_Handler(void) {
+	fprintf(stderr, "pool_soak: Error_Handler\n");
+	abort();
+}
+
+#include "block_pool.h"
+
+/* Boards with a second large block inflate compressed frames into it */
+#define COMPRESSED_FRAMES (POOL_LARGE_COUNT >= 2)
+
+/* Soak */
+#define OUTSTANDING 12
+
+typedef struct {
+	uint8_t* block;
+	size_t size;
+	uint8_t tag;
+} Live;
+
+static int failed = 0;
+
+#define CHECK(cond, ...) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "pool_soak: " __VA_ARGS__); \
+		fprintf(stderr, "\n"); \
+		failed = 1; \
+	} \
+} while (0)
+
+static uint8_t* allocTagged(Live* live, size_t size, uint8_t tag) {
+	live->block = poolAlloc(size);
+	live->size = size;
+	live->tag = tag;
+	if (live->block) {
+		memset(live->block, tag, size);
+	}
+	return live->block;
+}
+
+static void freeTagged(Live* live) {
+	if (!live->block) {
+		return;
+	}
+	for (size_t i = 0; i < live->size; i++) {
+		if (live->block[i] != live->tag) {
+			CHECK(0, "block %p of %lu bytes overwritten at %lu", (void*)live->block,
+					(unsigned long)live->size, (unsigned long)i);
+			break;
+		}
+	}
+	poolFree(live->block);
+	live->block = NULL;
+}
+
+/* Whether a request for size should have found a block */
+static int blockFree(size_t size) {
+	for (size_t c = 0; c < POOL_CLASSES; c++) {
+		if (size <= poolClasses[c].block_size && poolClasses[c].free_list != NULL) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* As the decoder: payload + 1 for the terminator, then the inflated text + 1 */
+static int frame(uint32_t payload, uint32_t text, uint8_t tag) {
+	Live data = {0}, inflated = {0};
+	int ok = allocTagged(&data, payload + 1, tag) != NULL;
+	if (ok && text) {
+		ok = allocTagged(&inflated, text + 1, (uint8_t)(tag ^ 0x5A)) != NULL;
+	}
+	freeTagged(&inflated);
+	freeTagged(&data);
+	return ok;
+}
+
+static void runFrames(int iterations) {
+	int failures = 0;
+	for (int i = 0; i < iterations; i++) {
+		uint32_t payload = 16 * (1 + rand() % (MAX_DATA_SIZE / 16));
+		uint32_t text = 0;
+		if (COMPRESSED_FRAMES && rand() % 2) {
+			text = payload + rand() % (MAX_DATA_SIZE - payload + 1);  // Compressed: text is larger
+		}
+		failures += !frame(payload, text, (uint8_t)i);
+	}
+	CHECK(failures == 0, "frames: %d of %d frames could not be stored", failures, iterations);
+	printf("frames  %8d frames, %d could not be stored\n", iterations, failures);
+}
+
+static void runSweep(void) {
+	int failures = 0, count = 0;
+	for (uint32_t payload = 16; payload <= MAX_DATA_SIZE; payload += 16) {
+		for (uint32_t text = payload; text <= MAX_DATA_SIZE; text += 97) {
+			failures += !frame(payload, text, (uint8_t)count);
+			count++;
+		}
+	}
+	CHECK(failures == 0, "sweep: %d of %d compressed frames could not be stored", failures, count);
+	printf("sweep   %8d compressed frames, %d could not be stored\n", count, failures);
+}
+
+static void runRandom(int iterations) {
+	Live live[OUTSTANDING] = {{0}};
+	int refused = 0;
+	for (int i = 0; i < iterations; i++) {
+		Live* slot = &live[rand() % OUTSTANDING];
+		if (slot->block) {
+			freeTagged(slot);
+			continue;
+		}
+		size_t size = 1 + rand() % POOL_LARGE_SIZE;
+		int expected = blockFree(size);
+		if (!allocTagged(slot, size, (uint8_t)(i | 1))) {
+			CHECK(!expected, "random: %lu bytes refused with a block free", (unsigned long)size);
+			refused++;
+		} else {
+			CHECK(expected, "random: %lu bytes served with no block free", (unsigned long)size);
+		}
+	}
+	for (int i = 0; i < OUTSTANDING; i++) {
+		freeTagged(&live[i]);
+	}
+	printf("random  %8d steps, %d refused while full\n", iterations, refused);
+}
+
+/* Nothing held, and each free list back to its whole class */
+static void checkEmpty(void) {
+	CHECK(poolStats.bytes_in_use == 0, "%lu bytes still in use", (unsigned long)poolStats.bytes_in_use);
+	for (size_t c = 0; c < POOL_CLASSES; c++) {
+		PoolClass* pc = &poolClasses[c];
+		int length = 0;
+		for (void** block = pc->free_list; block != NULL && length <= pc->block_count; block = *block) {
+			length++;
+		}
+		CHECK(pc->in_use == 0 && length == pc->block_count,
+				"class %lu: %u in use, %d of %u on the free list", (unsigned long)pc->block_size,
+				pc->in_use, length, pc->block_count);
+	}
+}
+
+int main(int argc, char** argv) {
+	int iterations = 1000000;
+	unsigned seed = 1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+		switch (opt) {
+		case 'n': iterations = atoi(optarg); break;
+		case 's': seed = (unsigned)atoi(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-n iterations] [-s seed]\n", argv[0]);
+			return 2;
+		}
+	}
+	srand(seed);
+	poolInit();
+
+	runFrames(iterations);
+	checkEmpty();
+	if (COMPRESSED_FRAMES) {
+		runSweep();
+		checkEmpty();
+	}
+	runRandom(iterations);
+	checkEmpty();
+
+	poolReport();
+	printf("%lu allocations, %lu failures, peak %lu bytes, %lu bytes in use at the end: %s\n",
+			(unsigned long)poolStats.allocations, (unsigned long)poolStats.failures,
+			(unsigned long)poolStats.peak_bytes, (unsigned long)poolStats.bytes_in_use,
+			failed ? "FAILED" : "ok");
+	return failed;
+}
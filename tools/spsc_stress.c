@@ -0,0 +1,208 @@
+/**
+ ******************************************************************************
+ * @file           : spsc_stress.c
+ * @brief          : Two-thread stress test of the firmware SPSC ring
+ ******************************************************************************
+ * Runs the SpscRing from spsc_ring.h, the one FINAL_ENCODER.c logs through,
+ * with a producer and a consumer thread standing in for printf and the
+ * huart2 DMA drain. Chunk sizes and consumer stalls are random, so the ring
+ * is driven full and empty across the wrap many times. Two phases, each with a copying consumer
+ * (ringPop) and a DMA-style one (ringPeek / ringAdvance):
+ *
+ *   wait   the producer retries until everything is queued - nothing may be
+ *          lost and overflows must stay 0
+ *   drop   the producer pushes once, as _write does when it cannot wait -
+ *          overflows must equal the bytes refused
+ *
+ * In both, the consumer must read back exactly the bytes the producer had
+ * accepted, in order.
+ *
+ *   cc -O2 -pthread -I. -o spsc_stress tools/spsc_stress.c
+ *   ./spsc_stress [-n megabytes] [-r ring_size] [-s seed]
+ *
+ * Build with -fsanitize=thread as well to have the ordering checked.
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* The ring under test is the firmware's own */
+#include "spsc_ring.h"
+
+void Error_Handler(void) {
+	fprintf(stderr, "spsc_stress: ring size must be a power of two\n");
+	exit(2);
+}
+
+/* Test */
+typedef struct {
+	SpscRing ring;
+	int drop;             // Producer pushes once instead of retrying
+	int peek;             // Consumer uses ringPeek / ringAdvance
+	size_t total;         // Bytes the producer offers
+	uint8_t* accepted;    // What the producer got into the ring, in order
+	size_t accepted_len;
+	uint8_t* received;    // What the consumer read
+	size_t received_len;
+	uint64_t refused;
+	volatile int done;
+	unsigned seed;
+} Run;
+
+/* xorshift - one state per thread, rand() is not thread safe */
+static uint32_t nextRandom(uint32_t* state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+/* Now and then back off, so the other side can fill or drain the ring */
+static void jitter(uint32_t* state) {
+	uint32_t r = nextRandom(state) % 1000;
+	if (r < 5) {
+		usleep(50);
+	} else if (r < 100) {
+		sched_yield();
+	}
+}
+
+static void* producer(void* arg) {
+	Run* run = arg;
+	uint32_t state = run->seed * 2654435761u | 1;
+	uint8_t chunk[300];
+	size_t offered = 0;
+
+	while (offered < run->total) {
+		uint32_t length = 1 + nextRandom(&state) % sizeof(chunk);
+		if (length > run->total - offered) {
+			length = (uint32_t)(run->total - offered);
+		}
+		for (uint32_t i = 0; i < length; i++) {
+			chunk[i] = (uint8_t)nextRandom(&state);
+		}
+
+		uint32_t queued = 0;
+		if (run->drop) {
+			queued = ringPush(&run->ring, chunk, length);
+		} else {
+			// As _write does while it may wait: only what fits, so nothing counts as overflow
+			while (queued < length) {
+				uint32_t space = ringSpace(&run->ring);
+				uint32_t count = (length - queued < space) ? length - queued : space;
+				queued += ringPush(&run->ring, chunk + queued, count);
+				if (queued < length) {
+					sched_yield();
+				}
+			}
+		}
+
+		memcpy(run->accepted + run->accepted_len, chunk, queued);
+		run->accepted_len += queued;
+		run->refused += length - queued;
+		offered += length;
+		jitter(&state);
+	}
+	__atomic_store_n(&run->done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void* consumer(void* arg) {
+	Run* run = arg;
+	uint32_t state = run->seed * 40503u | 1;
+
+	for (;;) {
+		int finished = __atomic_load_n(&run->done, __ATOMIC_ACQUIRE);
+		uint32_t count;
+		if (run->peek) {
+			uint8_t* data;
+			count = ringPeek(&run->ring, &data);
+			uint32_t limit = 1 + nextRandom(&state) % 512;  // DMA runs are capped too
+			if (count > limit) count = limit;
+			memcpy(run->received + run->received_len, data, count);
+			ringAdvance(&run->ring, count);
+		} else {
+			count = ringPop(&run->ring, run->received + run->received_len,
+					1 + nextRandom(&state) % 512);
+		}
+		run->received_len += count;
+		if (count == 0 && finished) {
+			break;
+		}
+		jitter(&state);
+	}
+	return NULL;
+}
+
+static int runOne(const char* name, int drop, int peek, size_t total, uint32_t ring_size, unsigned seed) {
+	static uint8_t storage[1 << 20];
+	Run run;
+	memset(&run, 0, sizeof(run));
+	ringInit(&run.ring, storage, ring_size);
+	run.drop = drop;
+	run.peek = peek;
+	run.total = total;
+	run.seed = seed;
+	run.accepted = malloc(total);
+	run.received = malloc(total);
+	if (!run.accepted || !run.received) {
+		perror("malloc");
+		exit(1);
+	}
+
+	pthread_t threads[2];
+	pthread_create(&threads[0], NULL, consumer, &run);
+	pthread_create(&threads[1], NULL, producer, &run);
+	pthread_join(threads[1], NULL);
+	pthread_join(threads[0], NULL);
+
+	int ok = run.received_len == run.accepted_len &&
+			memcmp(run.received, run.accepted, run.accepted_len) == 0 &&
+			run.ring.overflows == (uint32_t)run.refused &&
+			(drop || run.refused == 0) &&
+			run.ring.head == run.ring.tail &&
+			run.ring.high_water <= ring_size;
+	printf("%-4s %-4s %9lu offered %9lu received %8lu refused %8lu overflows  high water %5lu of %lu  %s\n",
+			name, peek ? "peek" : "pop", (unsigned long)total, (unsigned long)run.received_len,
+			(unsigned long)run.refused, (unsigned long)run.ring.overflows,
+			(unsigned long)run.ring.high_water, (unsigned long)ring_size, ok ? "ok" : "FAILED");
+	free(run.accepted);
+	free(run.received);
+	return ok;
+}
+
+int main(int argc, char** argv) {
+	size_t megabytes = 16;
+	uint32_t ring_size = 2048;  // LOG_RING_SIZE
+	unsigned seed = 1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:r:s:")) != -1) {
+		switch (opt) {
+		case 'n': megabytes = (size_t)atoi(optarg); break;
+		case 'r': ring_size = (uint32_t)atoi(optarg); break;
+		case 's': seed = (unsigned)atoi(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-n megabytes] [-r ring_size] [-s seed]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (ring_size > (1u << 20)) {
+		fprintf(stderr, "spsc_stress: ring size is at most %u\n", 1u << 20);
+		return 2;
+	}
+
+	size_t total = megabytes << 20;
+	int ok = 1;
+	ok &= runOne("wait", 0, 0, total, ring_size, seed);
+	ok &= runOne("wait", 0, 1, total, ring_size, seed + 1);
+	ok &= runOne("drop", 1, 0, total, ring_size, seed + 2);
+	ok &= runOne("drop", 1, 1, total, ring_size, seed + 3);
+	return ok ? 0 : 1;
+}
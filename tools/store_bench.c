@@ -0,0 +1,508 @@
+/**
+ ******************************************************************************
+ * @file           : store_bench.c
+ * @brief          : Host build of the encoder's content store and page cache
+ ******************************************************************************
+ * Reads a catalog image through the same LRU page cache, pinning and
+ * read-ahead as the content store in FINAL_ENCODER.c, backed by a file, and
+ * sweeps cache size and read-ahead over two workloads:
+ *
+ *   scan    the whole text once, as catalogCheck() does at boot
+ *   select  random selections of up to 40 lines, each listed and then read
+ *           again for encryption, as printSelectedText() does
+ *
+ *   python3 tools/pack_catalog.py content --binary catalog.bin
+ *   cc -O2 -o store_bench tools/store_bench.c
+ *   ./store_bench [-d nor|sd] [-c consumer_ns_per_byte] [-n selections] [-s seed] catalog.bin
+ *
+ * Target time is modeled: the device takes a fixed time per page (SPI NOR:
+ * command plus 512 bytes at 21 MHz; SD: access latency plus 512 bytes on a
+ * 4-bit 24 MHz bus) and runs while the consumer decodes, which costs -c ns
+ * per text byte - take it from the KB/s catalogCheck() prints with the
+ * flash store. Host throughput is the wall time through the file backend.
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Store and catalog - keep in step with the firmware */
+#define STORE_PAGE_SIZE 512
+#define STORE_MAX_PAGES 64
+#define STORE_NO_PAGE 0xFFFFFFFFu
+#define CATALOG_MAGIC "CCAT"
+#define CATALOG_VERSION 2
+#define CATALOG_WINDOW 256
+#define CATALOG_MATCH_MIN 3
+
+static const int BENCH_PAGES[] = {4, 8, 16, 32};
+#define BENCH_MAX_LINES 40
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+/* Device model */
+static double pageNs;          // One page read
+static double consumerNs = 120.0;
+static double simNs;           // Consumer clock
+static double deviceFreeNs;    // When the device finishes what it has
+
+static uint64_t nowMicros(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000u;
+}
+
+typedef struct {
+	uint32_t address;
+	const uint8_t* data;
+	uint32_t avail;
+	uint8_t pinned;
+} StoreCursor;
+
+typedef struct {
+	uint32_t page;
+	uint32_t last_use;
+	uint8_t pins;
+	uint8_t ahead;
+	double ready;  // Model: when the page is in
+} StoreSlot;
+
+typedef struct {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t ahead_reads;
+	uint32_t ahead_hits;
+	double stall_ns;
+	uint32_t device_bytes;
+} StoreStats;
+
+static int cachePages;
+static int readAhead;
+static uint8_t storeCache[STORE_MAX_PAGES][STORE_PAGE_SIZE];
+static StoreSlot storeSlots[STORE_MAX_PAGES];
+static uint32_t storeClock;
+static int storeInFlight;
+static uint32_t storeEnd;
+static StoreStats storeStats;
+static int storeFile = -1;
+
+static void storeDeviceRead(uint32_t page, uint8_t* dest, StoreSlot* slot) {
+	ssize_t n = pread(storeFile, dest, STORE_PAGE_SIZE, (off_t)page * STORE_PAGE_SIZE);
+	if (n < 0) {
+		perror("pread");
+		exit(1);
+	}
+	memset(dest + n, 0, STORE_PAGE_SIZE - n);
+	double start = simNs > deviceFreeNs ? simNs : deviceFreeNs;
+	deviceFreeNs = start + pageNs;
+	slot->ready = deviceFreeNs;
+}
+
+static int storeDone(void) {
+	return storeInFlight >= 0 && storeSlots[storeInFlight].ready <= simNs;
+}
+
+static void storeWait(void) {
+	if (storeInFlight < 0) {
+		return;
+	}
+	double ready = storeSlots[storeInFlight].ready;
+	if (ready > simNs) {
+		storeStats.stall_ns += ready - simNs;
+		simNs = ready;
+	}
+	storeInFlight = -1;
+}
+
+static int storeVictim(void) {
+	int victim = -1;
+	for (int i = 0; i < cachePages; i++) {
+		if (storeSlots[i].pins == 0 && i != storeInFlight &&
+				(victim < 0 || storeSlots[i].last_use < storeSlots[victim].last_use)) {
+			victim = i;
+		}
+	}
+	return victim;
+}
+
+static int storeFind(uint32_t page) {
+	for (int i = 0; i < cachePages; i++) {
+		if (storeSlots[i].page == page) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void storeLoad(int slot, uint32_t page, uint8_t ahead) {
+	storeSlots[slot].page = page;
+	storeSlots[slot].ahead = ahead;
+	storeSlots[slot].last_use = storeClock;
+	storeInFlight = slot;
+	storeStats.device_bytes += STORE_PAGE_SIZE;
+	storeDeviceRead(page, storeCache[slot], &storeSlots[slot]);
+}
+
+static int storeFetch(uint32_t page, uint8_t stream) {
+	if (storeDone()) {
+		storeWait();
+	}
+	int slot = storeFind(page);
+	storeClock++;
+	if (slot >= 0) {
+		if (slot == storeInFlight) {
+			storeWait();
+		}
+		storeStats.hits++;
+		if (storeSlots[slot].ahead) {
+			storeSlots[slot].ahead = 0;
+			storeStats.ahead_hits++;
+		}
+	} else {
+		storeWait();
+		slot = storeVictim();
+		storeStats.misses++;
+		storeLoad(slot, page, 0);
+		storeWait();
+	}
+	storeSlots[slot].last_use = storeClock;
+	if (!stream) {
+		return slot;
+	}
+	storeSlots[slot].pins++;
+
+	uint32_t next = page + 1;
+	if (readAhead && storeInFlight < 0 && next * STORE_PAGE_SIZE < storeEnd && storeFind(next) < 0) {
+		storeStats.ahead_reads++;
+		storeLoad(storeVictim(), next, 1);
+	}
+	return slot;
+}
+
+static void storeReset(void) {
+	for (int i = 0; i < STORE_MAX_PAGES; i++) {
+		storeSlots[i].page = STORE_NO_PAGE;
+		storeSlots[i].pins = 0;
+		storeSlots[i].ahead = 0;
+		storeSlots[i].last_use = 0;
+	}
+	storeClock = 0;
+	storeInFlight = -1;
+	memset(&storeStats, 0, sizeof(storeStats));
+	simNs = 0.0;
+	deviceFreeNs = 0.0;
+}
+
+static void cursorSeek(StoreCursor* cursor, uint32_t address) {
+	if (cursor->pinned) {
+		storeSlots[cursor->pinned - 1].pins--;
+		cursor->pinned = 0;
+	}
+	cursor->address = address;
+	cursor->avail = 0;
+}
+
+static void cursorMap(StoreCursor* cursor) {
+	uint32_t offset = cursor->address % STORE_PAGE_SIZE;
+	cursorSeek(cursor, cursor->address);
+	int slot = storeFetch(cursor->address / STORE_PAGE_SIZE, 1);
+	cursor->pinned = (uint8_t)(slot + 1);
+	cursor->data = &storeCache[slot][offset];
+	cursor->avail = STORE_PAGE_SIZE - offset;
+}
+
+static uint8_t cursorByte(StoreCursor* cursor) {
+	if (cursor->avail == 0) {
+		cursorMap(cursor);
+	}
+	cursor->address++;
+	cursor->avail--;
+	return *cursor->data++;
+}
+
+static void cursorRead(StoreCursor* cursor, uint8_t* dest, size_t length) {
+	if (!dest && length > cursor->avail) {
+		cursorSeek(cursor, cursor->address + length);
+		return;
+	}
+	while (length > 0) {
+		if (cursor->avail == 0) {
+			cursorMap(cursor);
+		}
+		size_t n = length < cursor->avail ? length : cursor->avail;
+		if (dest) {
+			memcpy(dest, cursor->data, n);
+			dest += n;
+		}
+		cursor->data += n;
+		cursor->address += n;
+		cursor->avail -= n;
+		length -= n;
+	}
+}
+
+static void storeRead(uint32_t address, void* dest, size_t length) {
+	uint8_t* out = dest;
+	while (length > 0) {
+		uint32_t offset = address % STORE_PAGE_SIZE;
+		size_t n = STORE_PAGE_SIZE - offset;
+		if (n > length) {
+			n = length;
+		}
+		memcpy(out, &storeCache[storeFetch(address / STORE_PAGE_SIZE, 0)][offset], n);
+		out += n;
+		address += n;
+		length -= n;
+	}
+}
+
+typedef struct {
+	char magic[4];
+	uint16_t version;
+	uint16_t paragraphs;
+	uint32_t lines;
+	uint16_t block_size;
+	uint16_t blocks;
+} CatalogHeader;
+
+static CatalogHeader catalogInfo;
+static const CatalogHeader* const catalog = &catalogInfo;
+
+typedef struct {
+	uint32_t pos;
+	uint32_t block_end;
+	StoreCursor in;
+	uint32_t literals;
+	uint32_t match;
+	uint8_t distance;
+	uint8_t window[CATALOG_WINDOW];
+} CatalogReader;
+
+static CatalogReader textReader;
+static CatalogReader gatherReader;
+
+static uint32_t catalogWord(uint32_t i) {
+	uint32_t word;
+	storeRead(sizeof(CatalogHeader) + i * 4u, &word, sizeof(word));
+	return word;
+}
+
+static uint32_t catalogOffset(uint32_t n) {
+	return catalogWord(catalog->paragraphs + 1 + n);
+}
+
+static uint32_t catalogData(void) {
+	uint32_t tables = catalog->paragraphs + 1 + catalog->lines + 1 +
+			(catalog->block_size ? catalog->blocks + 1 : 0);
+	return sizeof(CatalogHeader) + tables * 4u;
+}
+
+static uint32_t catalogBlock(uint32_t k) {
+	return catalogWord(catalog->paragraphs + 1 + catalog->lines + 1 + k);
+}
+
+static uint32_t readerLength(CatalogReader* reader, uint32_t nibble) {
+	uint32_t length = nibble;
+	if (nibble == 15) {
+		uint8_t b;
+		do {
+			b = cursorByte(&reader->in);
+			length += b;
+		} while (b == 255);
+	}
+	return length;
+}
+
+static void readerSequence(CatalogReader* reader) {
+	if (reader->pos == reader->block_end) {
+		uint32_t k = reader->pos / catalog->block_size;
+		uint32_t text_size = catalogOffset(catalog->lines);
+		uint32_t start = catalogData() + catalogBlock(k);
+		if (start != reader->in.address) {
+			cursorSeek(&reader->in, start);
+		}
+		reader->block_end = (text_size - reader->pos > catalog->block_size) ?
+				reader->pos + catalog->block_size : text_size;
+	}
+
+	uint8_t token = cursorByte(&reader->in);
+	reader->literals = readerLength(reader, token >> 4);
+	uint32_t code = readerLength(reader, token & 0x0F);
+	reader->match = code ? code + CATALOG_MATCH_MIN - 1 : 0;
+	if (reader->match) {
+		reader->distance = cursorByte(&reader->in);
+	}
+}
+
+static void catalogRead(CatalogReader* reader, uint8_t* dest, size_t length) {
+	if (catalog->block_size == 0) {
+		cursorRead(&reader->in, dest, length);
+		reader->pos += length;
+		return;
+	}
+
+	while (length > 0) {
+		uint8_t b;
+		if (reader->literals > 0) {
+			b = cursorByte(&reader->in);
+			reader->literals--;
+		} else if (reader->match > 0) {
+			b = reader->window[(reader->pos - reader->distance - 1) % CATALOG_WINDOW];
+			reader->match--;
+		} else {
+			readerSequence(reader);
+			continue;
+		}
+		reader->window[reader->pos % CATALOG_WINDOW] = b;
+		reader->pos++;
+		if (dest) {
+			*dest++ = b;
+		}
+		length--;
+	}
+}
+
+static void catalogOpen(CatalogReader* reader, uint32_t offset) {
+	reader->literals = 0;
+	reader->match = 0;
+	if (catalog->block_size == 0) {
+		reader->pos = offset;
+		cursorSeek(&reader->in, catalogData() + offset);
+		return;
+	}
+	reader->pos = offset - offset % catalog->block_size;
+	reader->block_end = reader->pos;
+	cursorSeek(&reader->in, 0xFFFFFFFFu);
+	catalogRead(reader, NULL, offset - reader->pos);
+}
+
+/* Bench */
+/* Text through a reader in 64-byte pieces, charging the consumer for each */
+static void consume(CatalogReader* reader, uint32_t length) {
+	uint8_t piece[64];
+	while (length > 0) {
+		uint32_t n = length < sizeof(piece) ? length : sizeof(piece);
+		catalogRead(reader, piece, n);
+		simNs += n * consumerNs;
+		length -= n;
+	}
+}
+
+/* Text bytes read by one pass of the workload */
+static uint64_t runScan(int selections) {
+	(void)selections;
+	uint32_t text_size = catalogOffset(catalog->lines);
+	catalogOpen(&textReader, 0);
+	consume(&textReader, text_size);
+	return text_size;
+}
+
+static uint64_t runSelect(int selections) {
+	uint64_t bytes = 0;
+	for (int i = 0; i < selections; i++) {
+		uint32_t first = (uint32_t)rand() % catalog->lines;
+		uint32_t last = first + (uint32_t)rand() % BENCH_MAX_LINES;
+		if (last >= catalog->lines) {
+			last = catalog->lines - 1;
+		}
+		uint32_t offset = catalogOffset(first);
+		uint32_t length = catalogOffset(last + 1) - offset;
+		catalogOpen(&textReader, offset);  // Listing
+		consume(&textReader, length);
+		catalogOpen(&gatherReader, offset);  // Encryption
+		consume(&gatherReader, length);
+		bytes += 2u * length;
+	}
+	return bytes;
+}
+
+static void runOne(const char* name, uint64_t (*workload)(int), int selections, unsigned seed) {
+	for (size_t p = 0; p < COUNT_OF(BENCH_PAGES); p++) {
+		for (readAhead = 0; readAhead <= 1; readAhead++) {
+			cachePages = BENCH_PAGES[p];
+			cursorSeek(&textReader.in, 0);
+			cursorSeek(&gatherReader.in, 0);
+			storeReset();
+			srand(seed);
+			uint64_t start = nowMicros();
+			uint64_t bytes = workload(selections);
+			uint64_t us = nowMicros() - start;
+
+			uint32_t lookups = storeStats.hits + storeStats.misses;
+			printf("%-6s %3d pages  ahead %s  %5.1f%% hits  %5lu/%-5lu ahead used  %7lu KB read  "
+					"%6.0f KB/s target (%4.1f%% stalled)  %7.1f MB/s host\n",
+					name, cachePages, readAhead ? "on " : "off",
+					lookups ? storeStats.hits * 100.0 / lookups : 100.0,
+					(unsigned long)storeStats.ahead_hits, (unsigned long)storeStats.ahead_reads,
+					(unsigned long)(storeStats.device_bytes / 1024u),
+					simNs > 0 ? bytes / 1024.0 / (simNs / 1e9) : 0.0,
+					simNs > 0 ? storeStats.stall_ns * 100.0 / simNs : 0.0,
+					us ? bytes / (double)us : 0.0);
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	const char* device = "nor";
+	int selections = 500;
+	unsigned seed = 1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:c:n:s:")) != -1) {
+		switch (opt) {
+		case 'd': device = optarg; break;
+		case 'c': consumerNs = atof(optarg); break;
+		case 'n': selections = atoi(optarg); break;
+		case 's': seed = (unsigned)atoi(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-d nor|sd] [-c consumer_ns_per_byte] [-n selections] [-s seed] catalog.bin\n",
+					argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc - 1) {
+		fprintf(stderr, "usage: %s [-d nor|sd] [-c consumer_ns_per_byte] [-n selections] [-s seed] catalog.bin\n",
+				argv[0]);
+		return 2;
+	}
+	if (strcmp(device, "nor") == 0) {
+		pageNs = (4 + STORE_PAGE_SIZE) * 8 * 1e9 / 21e6;  // 03h + address, then the page
+	} else if (strcmp(device, "sd") == 0) {
+		pageNs = 250e3 + STORE_PAGE_SIZE * 2 * 1e9 / 24e6;  // CMD17 access, then 4 bits a clock
+	} else {
+		fprintf(stderr, "store_bench: unknown device %s\n", device);
+		return 2;
+	}
+
+	storeFile = open(argv[optind], O_RDONLY);
+	if (storeFile < 0) {
+		perror(argv[optind]);
+		return 1;
+	}
+	cachePages = STORE_MAX_PAGES;
+	storeReset();
+	storeEnd = 0xFFFFFFFFu;
+	storeRead(0, &catalogInfo, sizeof(catalogInfo));
+	if (memcmp(catalog->magic, CATALOG_MAGIC, 4) != 0 || catalog->version != CATALOG_VERSION) {
+		fprintf(stderr, "store_bench: %s is not a version %d catalog image\n", argv[optind], CATALOG_VERSION);
+		return 1;
+	}
+	uint32_t text_size = catalogOffset(catalog->lines);
+	uint32_t stored = catalog->block_size ? catalogBlock(catalog->blocks) : text_size;
+	storeEnd = catalogData() + stored;
+
+	printf("Catalog: %u paragraphs, %lu lines, text %lu bytes, image %lu bytes\n",
+			catalog->paragraphs, (unsigned long)catalog->lines, (unsigned long)text_size,
+			(unsigned long)storeEnd);
+	printf("Device: %s, %.1f us a page; consumer %.0f ns a byte (%.0f KB/s unstalled)\n\n",
+			device, pageNs / 1000.0, consumerNs, 1e9 / consumerNs / 1024.0);
+	runOne("scan", runScan, selections, seed);
+	printf("\n");
+	runOne("select", runSelect, selections, seed);
+	close(storeFile);
+	return 0;
+}
@@ -0,0 +1,272 @@
+#!/usr/bin/env python3
+"""Train the shared payload dictionary on the lesson text.
+
+The encoder LZ77-codes every message against this dictionary before it is
+encrypted and the decoder inflates against the same bytes, so both boards
+include the header this writes:
+
+    python3 tools/train_dictionary.py content -o payload_dictionary.h
+
+Rerun it whenever content/ changes, and reflash both boards - frames carry
+the dictionary's CRC-32 and a decoder turns away any other.
+
+Training is a greedy cover: the corpus is every line as the encoder sends
+it, '\\n' included. Each candidate is a SEGMENT-byte run of it, scored by the
+number of lines that share each of its MATCH_MIN-grams not yet in the
+dictionary, and the best is taken until SIZE bytes are chosen. Chosen runs
+are kept in corpus order, so neighbouring runs join into longer matches. A
+corpus smaller than the dictionary simply ends up in it whole.
+
+The wire savings are reported twice. In-sample figures compress the text the
+dictionary was trained on, which is what the encoder sends until content/
+changes. Held-out figures compress each paragraph against a dictionary
+trained on the others, which is closer to new text sent before a retrain.
+
+Compressed messages are a run of sequences in the catalog's token format
+(see pack_catalog.py), except that the distance is two bytes, little-endian,
+counted back from the next output byte through the message's own output and
+on into the end of the dictionary. The encoder codes PIECE bytes of text at a
+time: a match lies within the piece or within the dictionary.
+"""
+import argparse
+import heapq
+import os
+import sys
+import zlib
+from collections import Counter
+
+from pack_catalog import lengthCode, readParagraphs
+
+MATCH_MIN = 4       # Must match DICT_MATCH_MIN in the firmware
+HASH_BITS = 8
+CHAIN_LIMIT = 16    # Must match DICT_CHAIN_LIMIT
+PIECE = 128         # Must match COMPRESS_PIECE
+NONE = 0xFFFF
+AES_BLOCK_SIZE = 16
+CODEC_SIZE = 8      # Dictionary CRC + text size, sent in clear with the frame
+BAUD = 115200
+
+
+def hash4(data, i):
+    """PAYLOAD_DICT_HASH - the firmware computes the same on four bytes."""
+    word = data[i] | data[i + 1] << 8 | data[i + 2] << 16 | data[i + 3] << 24
+    return ((word * 2654435761) & 0xFFFFFFFF) >> (32 - HASH_BITS)
+
+
+def grams(data):
+    return {bytes(data[i:i + MATCH_MIN]) for i in range(len(data) - MATCH_MIN + 1)}
+
+
+def train(samples, size, segment):
+    lineCount = Counter()
+    for sample in samples:
+        lineCount.update(grams(sample))
+
+    covered = set()
+    chosen = [bytearray(len(s)) for s in samples]
+    total = 0
+
+    def score(s, p):
+        return sum(lineCount[g] for g in grams(samples[s][p:p + segment]) if g not in covered)
+
+    # Lazy greedy: scores only fall as the dictionary grows
+    heap = [(-score(s, p), s, p) for s, sample in enumerate(samples)
+            for p in range(max(len(sample) - MATCH_MIN + 1, 0))]
+    heapq.heapify(heap)
+    while heap and total < size:
+        _, s, p = heapq.heappop(heap)
+        current = score(s, p)
+        if current == 0:
+            continue
+        if heap and current < -heap[0][0]:
+            heapq.heappush(heap, (-current, s, p))
+            continue
+        for i in range(p, min(p + segment, len(samples[s]))):
+            if not chosen[s][i] and total < size:
+                chosen[s][i] = 1
+                total += 1
+        covered |= grams(samples[s][p:p + segment])
+
+    dictionary = bytearray()
+    for sample, mask in zip(samples, chosen):
+        dictionary += bytes(b for b, keep in zip(sample, mask) if keep)
+    return bytes(dictionary)
+
+
+def hashIndex(dictionary):
+    """Hash chain heads and links, newest position first."""
+    head = [NONE] * (1 << HASH_BITS)
+    link = [NONE] * len(dictionary)
+    for k in range(len(dictionary) - MATCH_MIN + 1):
+        h = hash4(dictionary, k)
+        link[k] = head[h]
+        head[h] = k
+    return head, link
+
+
+def sequence(literals, match, distance):
+    literalNibble, literalExtension = lengthCode(len(literals))
+    code = match - MATCH_MIN + 1 if match else 0
+    matchNibble, matchExtension = lengthCode(code)
+    out = bytearray([literalNibble << 4 | matchNibble])
+    out += literalExtension + matchExtension
+    if match:
+        out += bytes([distance & 0xFF, distance >> 8])
+    return out + literals
+
+
+def compress(text, dictionary, head, link):
+    """The encoder's compressSelection, for the report below."""
+    out = bytearray()
+    for produced in range(0, len(text), PIECE):
+        piece = text[produced:produced + PIECE]
+        chains = {}
+        literalStart = i = 0
+        while i < len(piece):
+            best, bestDistance = 0, 0
+            if i + MATCH_MIN <= len(piece):
+                h = hash4(piece, i)
+                for j in chains.get(h, [])[:CHAIN_LIMIT]:
+                    length = 0
+                    while i + length < len(piece) and piece[j + length] == piece[i + length]:
+                        length += 1
+                    if length > best:
+                        best, bestDistance = length, i - j
+                k, tries = head[h], 0
+                while k != NONE and tries < CHAIN_LIMIT:
+                    distance = produced + i + len(dictionary) - k
+                    if distance > 0xFFFF:
+                        break
+                    length = 0
+                    while (i + length < len(piece) and k + length < len(dictionary) and
+                           dictionary[k + length] == piece[i + length]):
+                        length += 1
+                    if length > best:
+                        best, bestDistance = length, distance
+                    k, tries = link[k], tries + 1
+            if best < MATCH_MIN:
+                if i + MATCH_MIN <= len(piece):
+                    chains.setdefault(hash4(piece, i), []).insert(0, i)
+                i += 1
+                continue
+            out += sequence(piece[literalStart:i], best, bestDistance)
+            for k in range(i, min(i + best, len(piece) - MATCH_MIN + 1)):
+                chains.setdefault(hash4(piece, k), []).insert(0, k)
+            i += best
+            literalStart = i
+        if literalStart < len(piece):
+            out += sequence(piece[literalStart:], 0, 0)
+    return bytes(out)
+
+
+def padded(size):
+    return (size + AES_BLOCK_SIZE - 1) // AES_BLOCK_SIZE * AES_BLOCK_SIZE
+
+
+def wireBytes(messages, dictionary, head, link):
+    """Payload bytes on the wire without and with the dictionary"""
+    raw = sum(padded(len(m)) for m in messages)
+    packed = sum(padded(len(compress(m, dictionary, head, link))) + CODEC_SIZE for m in messages)
+    return raw, packed
+
+
+def report(name, count, raw, packed):
+    print("  %-16s %4d messages %7d -> %7d B (%3d%%), %6.1f ms less at %d baud" % (
+        name, count, raw, packed, packed * 100 // raw, (raw - packed) * 10000.0 / BAUD, BAUD))
+
+
+def paragraphText(paragraph):
+    return [line.encode("ascii") + b"\n" for line in paragraph]
+
+
+def heldOut(paragraphs, size, segment):
+    """Leave one paragraph out: each is compressed against a dictionary trained
+    on the others, as new content would be. Wire bytes of its lines and of the
+    paragraph as one message, summed over every paragraph."""
+    lines, whole = [0, 0], [0, 0]
+    for k, paragraph in enumerate(paragraphs):
+        others = [line for j, p in enumerate(paragraphs) if j != k for line in paragraphText(p)]
+        dictionary = train(others, size, segment)
+        head, link = hashIndex(dictionary)
+        text = paragraphText(paragraph)
+        for total, messages in ((lines, text), (whole, [b"".join(text)])):
+            raw, packed = wireBytes(messages, dictionary, head, link)
+            total[0] += raw
+            total[1] += packed
+    return lines, whole
+
+
+def writeHeader(path, dictionary, head, link, source, ratios):
+    crc = zlib.crc32(dictionary)
+    with open(path, "w") as f:
+        f.write("/* Payload dictionary - generated by tools/train_dictionary.py from %s/, do not edit.\n" % source)
+        f.write(" * Built into both encoder and decoder; see the tool for the format.\n")
+        f.write(" * Trained on all of %s/, so the in-sample ratio flatters it: paragraphs go\n" % source)
+        f.write(" * to %s of their padded size in-sample, %s held out (each paragraph against\n" % ratios)
+        f.write(" * a dictionary trained on the others). */\n")
+        f.write("#ifndef PAYLOAD_DICTIONARY_H\n#define PAYLOAD_DICTIONARY_H\n\n")
+        f.write("#include <stdint.h>\n\n")
+        f.write("#define PAYLOAD_DICT_SIZE %d\n" % len(dictionary))
+        f.write("#define PAYLOAD_DICT_CRC 0x%08XUL\n" % crc)
+        f.write("#define PAYLOAD_DICT_HASH_BITS %d\n" % HASH_BITS)
+        f.write("#define PAYLOAD_DICT_NONE 0x%04X\n\n" % NONE)
+        f.write("/* Hash of the four bytes at p, the key of the chains below */\n")
+        f.write("#define PAYLOAD_DICT_HASH(p) ((uint32_t)(((uint32_t)(p)[0] | (uint32_t)(p)[1] << 8 | \\\n")
+        f.write("\t\t(uint32_t)(p)[2] << 16 | (uint32_t)(p)[3] << 24) * 2654435761u) >> (32 - PAYLOAD_DICT_HASH_BITS))\n\n")
+
+        f.write("static const uint8_t PAYLOAD_DICT[%d] = {\n" % len(dictionary))
+        for i in range(0, len(dictionary), 16):
+            f.write("\t" + ", ".join("0x%02X" % b for b in dictionary[i:i + 16]) + ",\n")
+        f.write("};\n\n")
+
+        f.write("/* Match search index for the encoder - define PAYLOAD_DICT_INDEX to get it */\n")
+        f.write("#ifdef PAYLOAD_DICT_INDEX\n")
+        for name, table in (("PAYLOAD_DICT_HEAD", head), ("PAYLOAD_DICT_NEXT", link)):
+            f.write("static const uint16_t %s[%d] = {\n" % (name, len(table)))
+            for i in range(0, len(table), 12):
+                f.write("\t" + ", ".join("0x%04X" % v for v in table[i:i + 12]) + ",\n")
+            f.write("};\n")
+        f.write("#endif\n\n#endif /* PAYLOAD_DICTIONARY_H */\n")
+    return crc
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("directory", help="directory of paragraph .txt files")
+    parser.add_argument("-o", "--output", default="payload_dictionary.h", help="C header to write")
+    parser.add_argument("--size", type=int, default=1024, help="dictionary bytes")
+    parser.add_argument("--segment", type=int, default=32, help="bytes per chosen run")
+    args = parser.parse_args()
+    if not 0 < args.size <= 0xFFFF - PIECE or args.segment < MATCH_MIN:
+        sys.exit("train_dictionary: size must be 1..%d, segment at least %d" % (0xFFFF - PIECE, MATCH_MIN))
+
+    _, paragraphs = readParagraphs(args.directory)
+    lines = [line for paragraph in paragraphs for line in paragraphText(paragraph)]
+    dictionary = train(lines, args.size, args.segment)
+    head, link = hashIndex(dictionary)
+
+    inSample = [("single lines", len(lines), lines),
+                ("paragraphs", len(paragraphs), [b"".join(paragraphText(p)) for p in paragraphs]),
+                ("whole course", 1, [b"".join(lines)])]
+    inSample = [(name, count, wireBytes(messages, dictionary, head, link)) for name, count, messages in inSample]
+    heldLines, heldParagraphs = heldOut(paragraphs, args.size, args.segment) if len(paragraphs) > 1 else (None, None)
+
+    percent = lambda wire: "%d%%" % (wire[1] * 100 // wire[0]) if wire else "n/a"
+    ratios = (percent(inSample[1][2]), percent(heldParagraphs))
+    crc = writeHeader(args.output, dictionary, head, link, os.path.basename(os.path.normpath(args.directory)), ratios)
+
+    print("Dictionary %d bytes from %d lines (%d bytes), CRC 0x%08X" % (
+        len(dictionary), len(lines), sum(map(len, lines)), crc))
+    print("Payload on the wire, padded, with the %d-byte codec field" % CODEC_SIZE)
+    print(" in-sample - the dictionary was trained on this text:")
+    for name, count, wire in inSample:
+        report(name, count, *wire)
+    if heldLines:
+        print(" held out - each paragraph against a dictionary trained on the others:")
+        report("single lines", len(lines), *heldLines)
+        report("paragraphs", len(paragraphs), *heldParagraphs)
+    else:
+        print(" held out - needs at least two paragraphs")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""Split the multiplexed huart2 stream from main_encoder.c / main_decoder.c.
+
+Frames are SOF (0x7E), channel, length, payload, XOR checksum over
+channel/length/payload. Channel 1 carries the encrypted data stream,
+channel 2 carries printf log output.
+
+    python3 tools/uart_demux.py /dev/ttyACM0 --data capture.bin
+
+The input can be a serial device (configure it first, e.g.
+`stty -F /dev/ttyACM0 115200 raw`) or a raw capture file.
+"""
+import argparse
+import sys
+
+MUX_SOF = 0x7E
+MUX_CHANNEL_DATA = 0x01
+MUX_CHANNEL_LOG = 0x02
+
+
+def frames(stream):
+    """Yield (channel, payload) for every frame with a valid checksum.
+
+    On a bad checksum only the SOF byte is dropped, so a 0x7E inside a
+    payload cannot swallow the real frame that follows it.
+    """
+    buf = bytearray()
+    bad = 0
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            break
+        buf += chunk
+        while True:
+            start = buf.find(MUX_SOF)
+            if start < 0:
+                buf.clear()
+                break
+            del buf[:start]
+            if len(buf) < 3 or len(buf) < 4 + buf[2]:
+                break
+            channel, length = buf[1], buf[2]
+            payload = bytes(buf[3:3 + length])
+            expected = channel ^ length
+            for x in payload:
+                expected ^= x
+            if expected != buf[3 + length]:
+                bad += 1
+                del buf[:1]
+                continue
+            del buf[:4 + length]
+            yield channel, payload
+    if bad:
+        sys.stderr.write("uart_demux: %d bad frames\n" % bad)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="serial device or capture file")
+    parser.add_argument("--data", help="write the data channel to this file")
+    args = parser.parse_args()
+
+    data_out = open(args.data, "wb") if args.data else None
+    log_out = sys.stdout.buffer
+
+    with open(args.input, "rb", buffering=0) as stream:
+        for channel, payload in frames(stream):
+            if channel == MUX_CHANNEL_LOG:
+                log_out.write(payload)
+                log_out.flush()
+            elif channel == MUX_CHANNEL_DATA and data_out:
+                data_out.write(payload)
+                data_out.flush()
+
+    if data_out:
+        data_out.close()
+
+
+if __name__ == "__main__":
+    main()